@@ -3,228 +3,1096 @@
 // Copyright 2025 Eric Smith
 // SPDX-License-Identifier: GPL-3.0-only
 
+#include <algorithm>
 #include <format>
-#include <iostream>
+#include <future>
+#include <iterator>
+#include <memory>
 #include <stdexcept>
+#include <thread>
 
 #include "assembler.hh"
 
 AssemblerError::AssemblerError(const std::string& what):
-  std::runtime_error(std::format("Error: {}", what))
+  std::runtime_error(std::format("Error: {}", what)),
+  m_message(what),
+  m_source_line_number(0)
 {
 }
 
 AssemblerError::AssemblerError(std::size_t source_line_number,
 			       const std::string& what):
-  std::runtime_error(std::format("Error at line {}: {}", source_line_number, what))
+  std::runtime_error(std::format("Error at line {}: {}", source_line_number, what)),
+  m_message(what),
+  m_source_line_number(source_line_number)
 {
 }
 
-std::string untabify(const std::string& s)
+const std::string& AssemblerError::get_message() const
 {
-  unsigned col = 0;
-  std::string result;
-  for (char c: s)
+  return m_message;
+}
+
+std::size_t AssemblerError::get_source_line_number() const
+{
+  return m_source_line_number;
+}
+
+Assembler::Assembler(std::shared_ptr<InstructionSet> instruction_set_sp,
+		     std::shared_ptr<PseudoOp> pseudo_op_sp,
+		     std::filesystem::path source_filename)
+{
+  m_source_filename = source_filename.string();
+  m_diagnostic_sink_sp = BufferedDiagnosticSink::create();
+  m_source_buffer_sp = SourceBuffer::create(source_filename);
+  m_source_lines.resize(m_source_buffer_sp->line_count());
+
+  m_instruction_set_sp = instruction_set_sp;
+  m_pseudo_op_sp = pseudo_op_sp;
+  m_symbol_table_sp = SymbolTable::create();
+  m_ast_arena_sp = ASTArena::create();
+  m_parser_sp = Parser::create(m_instruction_set_sp, m_symbol_table_sp, m_ast_arena_sp);
+  m_memory_image_sp = MemoryImage::create();
+  m_line_table_sp = LineTable::create(m_source_lines.size());
+  m_object_code_pool = & m_line_table_sp->get_pool();
+  m_cross_reference_sp = CrossReference::create();
+}
+
+Assembler::Assembler(const Assembler* parent)
+{
+  m_source_filename = parent->m_source_filename;
+  m_diagnostic_sink_sp = BufferedDiagnosticSink::create();
+  m_source_buffer_sp = parent->m_source_buffer_sp;
+  m_instruction_set_sp = parent->m_instruction_set_sp;
+  m_pseudo_op_sp = parent->m_pseudo_op_sp;
+  m_symbol_table_sp = parent->m_symbol_table_sp;
+  m_ast_arena_sp = parent->m_ast_arena_sp;
+  m_parser_sp = parent->m_parser_sp;
+  m_line_table_sp = parent->m_line_table_sp;
+  m_object_code_pool = & m_worker_object_code_pool;
+
+  m_pass_number = parent->m_pass_number;
+  m_final_pass = true;
+  m_symbols_frozen = true;
+}
+
+void Assembler::set_diagnostic_sink(std::shared_ptr<DiagnosticSink> diagnostic_sink_sp)
+{
+  m_diagnostic_sink_sp = diagnostic_sink_sp;
+}
+
+std::shared_ptr<DiagnosticSink> Assembler::get_diagnostic_sink() const
+{
+  return m_diagnostic_sink_sp;
+}
+
+void Assembler::report(Severity severity,
+		       unsigned source_line_number,
+		       const std::string& message,
+		       unsigned column)
+{
+  switch (severity)
   {
-    if (c == '\t')
+  case Severity::WARNING:
+    ++m_warning_count;
+    break;
+  case Severity::ERROR:
+  case Severity::FATAL:
+    ++m_error_count;
+    break;
+  default:
+    break;
+  }
+  m_diagnostic_sink_sp->report(Diagnostic { .severity = severity,
+					     .file     = m_source_filename,
+					     .line     = source_line_number,
+					     .column   = column,
+					     .message  = message });
+}
+
+Assembler::~Assembler()
+{
+}
+
+ValueExpected<Value> Assembler::evaluate(const ExpressionProgram& program) const
+{
+  if (program.empty())
+  {
+    throw AssemblerError(m_source_line_number, "evaluate empty expression");
+  }
+  ExpressionEvaluationContext context { *m_symbol_table_sp,
+					m_source_line_number,
+					m_location_counter };
+  return program.evaluate(context);
+}
+
+ValueExpected<std::uint16_t> Assembler::evaluate_uint16(const ExpressionProgram& program) const
+{
+  ValueExpected<Value> value = evaluate(program);
+  return value ? value->try_get() : std::unexpected(value.error());
+}
+
+std::uint16_t Assembler::convert_operand_uint16(const ExpressionProgram& program)
+{
+  // Forward references are the normal case in pass 1, so they are
+  // handled without throwing.
+  ValueExpected<std::uint16_t> number = evaluate_uint16(program);
+  if (number)
+  {
+    return *number;
+  }
+  switch (number.error())
+  {
+  case ValueErrorKind::UNKNOWN:
+    if (m_single_pass)
     {
-      do
-      {
-	result += ' ';
-	++col;
-      }
-      while (col & 7);
+      // the caller either emits the operand through emit_operand(),
+      // which records a fixup, or rejects the forward reference
+      m_unresolved_operand = &program;
+      return 0x0100;  // value that won't be interpreted as page zero
     }
-    else
+    if (! m_final_pass)
     {
-      result += c;
-      ++col;
+      ++m_forward_references;
+      m_line_cacheable = false;
+      return 0x0100;  // value that won't be interpreted as page zero
     }
+    break;
+  case ValueErrorKind::DIVIDE_BY_ZERO:
+    throw AssemblerError(m_source_line_number, "division by zero");
   }
-  return result;
+  throw AssemblerError(m_source_line_number, "expression evaluation error");
+}
+
+void Assembler::set_single_pass(bool single_pass)
+{
+  m_single_pass = single_pass;
+}
+
+void Assembler::set_check_only(bool check_only)
+{
+  m_check_only = check_only;
+}
+
+void Assembler::set_jobs(unsigned jobs)
+{
+  m_jobs = jobs ? jobs : std::max(1u, std::thread::hardware_concurrency());
 }
 
-Assembler::Assembler(std::filesystem::path source_filename,
-		     std::filesystem::path object_filename,
-		     std::filesystem::path listing_filename)
+void Assembler::add_object_file(ObjectFormat format,
+				std::filesystem::path filename)
 {
-  m_source_file.open(source_filename, std::ios::in);
-  if (! m_source_file.is_open())
+  std::ofstream file(filename, std::ios::out | std::ios::binary);
+  if (! file.is_open())
   {
-    throw AssemblerError("can't open source file");
+    throw AssemblerError(std::format("can't open object file {}", filename.string()));
   }
+  m_object_files.push_back(ObjectFile { format, std::move(file) });
+}
+
+void Assembler::set_fill_byte(std::uint8_t fill_byte)
+{
+  m_fill_byte = fill_byte;
+}
 
-  m_object_file.open(object_filename, std::ios::out | std::ios::binary);
-  if (! m_object_file.is_open())
+void Assembler::set_listing_file(std::filesystem::path filename)
+{
+  m_listing_file.open(filename, std::ios::out);
+  if (! m_listing_file.is_open())
   {
-    throw AssemblerError("can't open object file");
+    throw AssemblerError(std::format("can't open listing file {}", filename.string()));
   }
+  m_listing_sp = Listing::create(m_listing_file, m_source_filename);
+  m_listing_sp->set_page_length(m_listing_page_length);
+}
 
-  m_listing_file.open(listing_filename, std::ios::out);
-  if (! m_listing_file.is_open())
+void Assembler::set_listing_page_length(unsigned page_length)
+{
+  m_listing_page_length = page_length;
+  if (m_listing_sp)
   {
-    throw AssemblerError("can't open listing file");
+    m_listing_sp->set_page_length(page_length);
   }
+}
 
-  m_instruction_set_sp = InstructionSet::create();
-  m_pseudo_op_sp = PseudoOp::create();
-  m_parser_sp = Parser::create(m_instruction_set_sp, m_symbol_table_sp);
-  m_symbol_table_sp = SymbolTable::create();
+void Assembler::set_writer_thread(bool writer_thread)
+{
+  m_writer_thread = writer_thread;
 }
 
-Assembler::~Assembler()
+// Most diagnostics are reported by the final pass in line order, but
+// errors from single-pass fixups and overlap warnings from building the
+// memory image are only found after the pass. All of them are held
+// until assembly is complete, or stopped by an exception, and then
+// passed to the sink in line order.
+void Assembler::assemble()
 {
+  std::shared_ptr<DiagnosticSink> diagnostic_sink_sp = m_diagnostic_sink_sp;
+  auto held_diagnostics_sp = BufferedDiagnosticSink::create();
+  m_diagnostic_sink_sp = held_diagnostics_sp;
+  auto release_diagnostics = [&] ()
+  {
+    m_diagnostic_sink_sp = diagnostic_sink_sp;
+    held_diagnostics_sp->sort_by_line();
+    for (const Diagnostic& diagnostic: held_diagnostics_sp->get())
+    {
+      m_diagnostic_sink_sp->report(diagnostic);
+    }
+  };
+
+  try
+  {
+    assemble_passes();
+  }
+  catch (...)
+  {
+    release_diagnostics();
+    throw;
+  }
+  release_diagnostics();
 }
 
-ValueSP Assembler::evaluate(ExpressionSP expression_sp) const
+void Assembler::assemble_passes()
 {
-  if (! expression_sp)
+  if (m_single_pass)
+  {
+    assemble_single_pass();
+    return;
+  }
+
+  // In pass 1, forward references are sized as absolute. Each later
+  // sizing pass uses the label values from the pass before, so it can
+  // choose zero page where the value allows, which may in turn move
+  // labels. Addresses have converged when pass 1 had no forward
+  // references, or a later pass moved no labels.
+  int pass_number = 1;
+  while (true)
   {
-#if 0
-    if (nullptr_returns_default_value)
+    assemble_pass(pass_number, false);
+    bool converged = (pass_number == 1) ? (m_forward_references == 0) : (m_symbols_changed == 0);
+    if (converged)
+    {
+      break;
+    }
+    if (pass_number == MAX_SIZING_PASSES)
     {
-      return Value();
+      throw AssemblerError(std::format("addresses did not converge after {} passes", pass_number));
     }
-#endif
-    throw AssemblerError(m_source_line_number, "evaluate nullptr expression");
+    ++pass_number;
+  }
+  if (m_jobs > 1)
+  {
+    assemble_final_pass_parallel(pass_number + 1);
+  }
+  else
+  {
+    assemble_pass(pass_number + 1, true);
   }
-  ExpressionEvaluationContext context { m_symbol_table_sp,
-					m_source_line_number };
-  return expression_sp->evaluate(context);
 }
 
-std::uint16_t Assembler::convert_operand_uint16(ExpressionSP expression_sp)
+void Assembler::assemble_single_pass()
 {
-  ValueSP value_sp = evaluate(expression_sp);
-  try
+  // The only pass is also the final pass, except that forward
+  // references are allowed in operands, and the output can't be
+  // written until the fixups for them have been applied.
+  m_fixups.clear();
+  assemble_pass(1, true);
+  apply_fixups();
+  build_memory_image();
+  if (! m_check_only)
   {
-    return value_sp->get();
+    write_listing();
+    write_object_files();
   }
-  catch (const ValueUnknownError& e)
+
+  // errors from the fixups and the memory image are reported after
+  // the pass
+  PassStatistics& statistics = m_pass_statistics.back();
+  statistics.fixup_count = m_fixups.size();
+  statistics.error_count = m_error_count;
+  statistics.warning_count = m_warning_count;
+}
+
+void Assembler::apply_fixups()
+{
+  m_symbol_table_sp->set_lookup_undefined_ok(false);
+  for (const Fixup& fixup: m_fixups)
   {
-    if (m_pass_number == 1)
+    m_source_line_number = fixup.source_line_number;
+    m_location_counter = fixup.location_counter;
+    ValueExpected<std::uint16_t> number;
+    try
     {
-      return 0x0100;  // value that won't be interpreted as page zero
+      number = evaluate_uint16(*fixup.program);
+    }
+    catch (const SymbolTableError& e)
+    {
+      report(Severity::ERROR, m_source_line_number, e.what());
+      continue;
+    }
+    if (! number)
+    {
+      report(Severity::ERROR,
+	     m_source_line_number,
+	     (number.error() == ValueErrorKind::DIVIDE_BY_ZERO) ? "division by zero" : "expression evaluation error");
+      continue;
+    }
+    std::uint16_t value = *number;
+
+    std::span<std::uint8_t> bytes = m_line_table_sp->get_object_code(fixup.line_index);
+    switch (fixup.kind)
+    {
+    case Fixup::Kind::ABSOLUTE:
+      bytes[fixup.offset]     = value & 0xff;
+      bytes[fixup.offset + 1] = value >> 8;
+      break;
+    case Fixup::Kind::LOW_BYTE:
+      bytes[fixup.offset] = value & 0xff;
+      break;
+    case Fixup::Kind::HIGH_BYTE:
+      bytes[fixup.offset] = value >> 8;
+      break;
+    case Fixup::Kind::RELATIVE:
+      {
+	std::int32_t displacement = value - (fixup.location_counter + 2);
+	if ((displacement < std::numeric_limits<std::int8_t>::min()) ||
+	    (displacement > std::numeric_limits<std::int8_t>::max()))
+	{
+	  report(Severity::ERROR,
+		 m_source_line_number,
+		 std::format("relative branch displacement {} out of range",
+			     displacement));
+	  continue;
+	}
+	bytes[fixup.offset] = displacement & 0xff;
+      }
+      break;
     }
-    throw AssemblerError(m_source_line_number, "expression evaluation error");
   }
 }
 
-void Assembler::assemble()
+// The listing is written from the recorded output of each line once
+// the final pass is complete, since the list state and pagination
+// depend on every line before.
+void Assembler::write_listing()
+{
+  if (! m_listing_sp)
+  {
+    return;
+  }
+  m_listing_sp->start();
+  for (std::size_t index = 0; index < m_source_lines_assembled; index++)
+  {
+    m_listing_sp->list_line(make_listing_line(index));
+  }
+  list_symbol_table();
+  m_listing_sp->flush();
+}
+
+Listing::Line Assembler::make_listing_line(std::size_t index) const
+{
+  const LineTable& line_table = *m_line_table_sp;
+  std::span<const std::uint8_t> object_code = line_table.get_object_code(index);
+  std::optional<std::uint16_t> address;
+  if ((line_table.get_flags(index) & LineTable::SHOW_ADDRESS) || object_code.size())
+  {
+    address = line_table.get_address(index);
+  }
+  return Listing::make_line(index + 1,
+			    m_source_lines[index].text,
+			    line_table.get_listing_control(index),
+			    address,
+			    object_code,
+			    line_table.get_word_starts(index));
+}
+
+// Queues the lines from the first not yet queued up to end, which
+// must all have been assembled by the final pass. Unless waiting,
+// stops at the first line that doesn't fit, to be queued later.
+void Assembler::queue_listing_lines(std::size_t end,
+				    bool wait)
+{
+  while (m_listing_queued_lines < end)
+  {
+    Listing::Line line = make_listing_line(m_listing_queued_lines);
+    if (wait)
+    {
+      m_listing_writer_sp->list_line(line);
+    }
+    else if (! m_listing_writer_sp->try_list_line(line))
+    {
+      return;
+    }
+    ++m_listing_queued_lines;
+  }
+}
+
+// The object code of each line is copied into the memory image in line
+// order, so that an overlap is attributed to the later line whether or
+// not the final pass ran in parallel. Overlapping code is only a
+// warning, since deliberately assembling over earlier code with .loc
+// was always accepted; the later line's bytes are kept.
+void Assembler::build_memory_image()
 {
-  for (int p = 1; p <= 2; ++p)
+  m_memory_image_sp->clear();
+  for (std::size_t index = 0; index < m_source_lines_assembled; index++)
   {
-    assemble_pass(p);
+    std::span<const std::uint8_t> object_code = m_line_table_sp->get_object_code(index);
+    if (object_code.empty())
+    {
+      continue;
+    }
+    unsigned source_line_number = index + 1;
+    std::optional<MemoryImage::Overlap> overlap = m_memory_image_sp->write(m_line_table_sp->get_address(index),
+									   object_code,
+									   source_line_number);
+    if (overlap)
+    {
+      report(Severity::WARNING,
+	     source_line_number,
+	     std::format("object code at {:04x} overlaps object code from line {}",
+			 overlap->address,
+			 overlap->source_line_number));
+    }
   }
 }
 
-void Assembler::assemble_pass(int pass_number)
+void Assembler::write_object_files()
 {
-  if ((pass_number < 1) || (pass_number > 2))
+  std::string s;
+  for (ObjectFile& object_file: m_object_files)
   {
-    throw AssemblerError(m_source_line_number, std::format("invalid pass number {}", pass_number));
+    s.clear();
+    render_object(s, *m_memory_image_sp, object_file.format, m_fill_byte);
+    object_file.file.write(s.data(), s.size());
   }
+}
 
-  std::cout << std::format("starting pass {}\n", pass_number);
+std::shared_ptr<const MemoryImage> Assembler::get_memory_image() const
+{
+  return m_memory_image_sp;
+}
+
+std::shared_ptr<const LineTable> Assembler::get_line_table() const
+{
+  return m_line_table_sp;
+}
 
+void Assembler::start_pass(int pass_number,
+			   bool final_pass)
+{
+  m_pass_start_time = std::chrono::steady_clock::now();
   m_pass_number = pass_number;
+  m_final_pass = final_pass;
   m_end_reached = false;
   m_error_count = 0;
   m_warning_count = 0;
+  m_symbols_changed = 0;
+  m_forward_references = 0;
+  m_byte_count = 0;
+  m_replayed_lines = 0;
+  m_fixed_size_lines = 0;
 
-  m_prev_object_code_address = -1;  // guaranteed not to match any real address
+  m_symbol_table_sp->set_lookup_undefined_ok((! m_final_pass) || m_single_pass);
+  m_symbol_table_sp->set_redefinition_ok(! m_final_pass);
 
-  m_symbol_table_sp->set_lookup_undefined_ok(m_pass_number == 1);
+  m_source_line_number = 0;
+  m_location_counter = 0;
+
+  m_line_table_sp->start_pass();
+}
+
+void Assembler::finish_pass()
+{
+  m_pass_statistics.push_back(PassStatistics { .pass_number           = m_pass_number,
+						.final_pass            = m_final_pass,
+						.line_count            = m_source_line_number,
+						.replayed_line_count   = m_replayed_lines,
+						.fixed_size_line_count = m_fixed_size_lines,
+						.byte_count            = m_byte_count,
+						.symbols_changed       = m_symbols_changed,
+						.forward_references    = m_forward_references,
+						.error_count           = m_error_count,
+						.warning_count         = m_warning_count,
+						.chunk_count           = 1,
+						.fixup_count           = 0,
+						.elapsed               = std::chrono::steady_clock::now() - m_pass_start_time });
+}
 
-  if (m_pass_number != 1)
+const std::vector<Assembler::PassStatistics>& Assembler::get_pass_statistics() const
+{
+  return m_pass_statistics;
+}
+
+void Assembler::assemble_pass(int pass_number,
+			      bool final_pass)
+{
+  start_pass(pass_number, final_pass);
+
+  bool parse_serially = (m_pass_number == 1) && (m_jobs == 1);
+  if ((m_pass_number == 1) && ! parse_serially)
   {
-    m_source_file.clear(); // seekg will clear the eof bit, but not the fail bit
-    m_source_file.seekg(0, std::ios::beg);  // rewind source file
+    parse_source_lines_parallel();
+  }
+
+  if (m_final_pass && (! m_single_pass) && (! m_check_only) && m_writer_thread && m_listing_sp)
+  {
+    m_listing_sp->start();
+    m_listing_writer_sp = ListingWriter::create(m_listing_sp);
+    m_listing_queued_lines = 0;
+  }
+
+  while ((! m_end_reached) && (m_source_line_number < m_source_lines.size()))
+  {
+    std::size_t index = m_source_line_number++;
+    SourceLine& source_line = m_source_lines[index];
+    if (parse_serially)
+    {
+      parse_source_line(index, *m_parser_sp);
+    }
+
+    if ((! m_final_pass) && source_line.fixed_size && define_fixed_size_label(source_line))
+    {
+      m_location_counter += *source_line.fixed_size;
+      m_byte_count += *source_line.fixed_size;
+      ++m_fixed_size_lines;
+      continue;
+    }
+
+    assemble_source_line(source_line);
+
+    m_location_counter += get_line_size() + m_skipped_bytes;
+    m_byte_count += get_line_size();
+
+    if (m_listing_writer_sp)
+    {
+      queue_listing_lines(m_source_line_number, false);
+    }
+  }
+  m_source_lines_assembled = m_source_line_number;
+
+  if (m_listing_writer_sp)
+  {
+    queue_listing_lines(m_source_lines_assembled, true);
+    m_listing_writer_sp->finish();
+    m_listing_writer_sp.reset();
+    list_symbol_table();
+    m_listing_sp->flush();
+  }
+  else if (m_final_pass && (! m_single_pass) && (! m_check_only))
+  {
+    write_listing();
+  }
+  if (m_final_pass && ! m_single_pass)
+  {
+    build_memory_image();
+    if (! m_check_only)
+    {
+      write_object_files();
+    }
+  }
+
+  finish_pass();
+}
+
+void Assembler::assemble_final_pass_parallel(int pass_number)
+{
+  start_pass(pass_number, true);
+  m_symbols_frozen = true;
+
+  // Split the lines assembled by the last sizing pass into one chunk
+  // per job. Each chunk starts where the last sizing pass left the
+  // location counter, which is final.
+  struct Chunk
+  {
+    std::size_t begin;
+    std::size_t end;
+    std::unique_ptr<Assembler> worker;
+    std::shared_ptr<BufferedDiagnosticSink> diagnostics;
+    std::future<void> done;
+  };
+  std::size_t line_count = m_source_lines_assembled;
+  std::size_t chunk_count = std::max<std::size_t>(1, std::min<std::size_t>(m_jobs, line_count));
+  std::vector<Chunk> chunks(chunk_count);
+
+  for (std::size_t i = 0; i < chunk_count; i++)
+  {
+    Chunk& chunk = chunks[i];
+    chunk.begin = (i * line_count) / chunk_count;
+    chunk.end = ((i + 1) * line_count) / chunk_count;
+    chunk.worker = std::unique_ptr<Assembler>(new Assembler(this));
+    chunk.diagnostics = BufferedDiagnosticSink::create();
+    chunk.worker->set_diagnostic_sink(chunk.diagnostics);
+  }
+
+  std::span<SourceLine> source_lines(m_source_lines);
+  for (Chunk& chunk: chunks)
+  {
+    chunk.done = std::async(std::launch::async,
+			    & Assembler::assemble_final_lines,
+			    chunk.worker.get(),
+			    source_lines.subspan(chunk.begin, chunk.end - chunk.begin),
+			    chunk.begin);
   }
-  m_source_line_number = 0;
 
-  while ((! m_end_reached) && std::getline(m_source_file, m_source_line))
+  // Wait for every chunk before writing anything, and report the
+  // error from the earliest chunk, as a serial pass would.
+  for (Chunk& chunk: chunks)
+  {
+    chunk.done.wait();
+  }
+  std::vector<std::uint8_t>& pool = m_line_table_sp->get_pool();
+  for (Chunk& chunk: chunks)
   {
-    m_source_line = untabify(m_source_line);
-    ++m_source_line_number;
+    chunk.done.get();
+    m_line_table_sp->rebase(chunk.begin, chunk.end, pool.size());
+    pool.insert(pool.end(),
+		chunk.worker->m_worker_object_code_pool.begin(),
+		chunk.worker->m_worker_object_code_pool.end());
+    for (const Diagnostic& diagnostic: chunk.diagnostics->get())
+    {
+      m_diagnostic_sink_sp->report(diagnostic);
+    }
+    m_error_count += chunk.worker->m_error_count;
+    m_warning_count += chunk.worker->m_warning_count;
+    m_byte_count += chunk.worker->m_byte_count;
+    m_replayed_lines += chunk.worker->m_replayed_lines;
+  }
+  m_source_line_number = line_count;
+  m_symbols_frozen = false;
 
+  build_memory_image();
+  if (! m_check_only)
+  {
+    write_listing();
+    write_object_files();
+  }
+
+  finish_pass();
+  m_pass_statistics.back().chunk_count = chunk_count;
+}
+
+void Assembler::assemble_final_lines(std::span<SourceLine> source_lines,
+				     std::size_t first_index)
+{
+  if (source_lines.size())
+  {
+    m_location_counter = source_lines[0].location_counter;
+  }
+  for (std::size_t i = 0; i < source_lines.size(); i++)
+  {
+    SourceLine& source_line = source_lines[i];
+    m_source_line_number = first_index + i + 1;
+    assemble_source_line(source_line);
+    m_location_counter += get_line_size() + m_skipped_bytes;
+    m_byte_count += get_line_size();
+  }
+}
+
+// In a sizing pass, a line whose size is known from its statement
+// alone only needs its label defined. Returns false if the label
+// can't be defined, e.g., because it is a duplicate, in which case the
+// line must be assembled, so that the error is handled as for any
+// other line.
+bool Assembler::define_fixed_size_label(SourceLine& source_line)
+{
+  m_statement = source_line.statement;
+  source_line.location_counter = m_location_counter;
+  if (m_statement->has_label())
+  {
+    try
+    {
+      define_symbol(m_statement->get_label(), Value(m_location_counter));
+    }
+    catch (const AssemblerError&)
+    {
+      return false;
+    }
+    catch (const SymbolTableError&)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Assembler::assemble_source_line(SourceLine& source_line)
+{
+  m_statement = source_line.statement;
+  source_line.location_counter = m_location_counter;
+
+  m_object_code_address = m_location_counter;
+  m_skipped_bytes = 0;
+  m_line_start = m_object_code_pool->size();
+  if (can_replay(source_line))
+  {
+    replay_line();
+  }
+  else
+  {
     m_listing_show_address = false;
-    m_object_code_address = m_location_counter;
-    m_object_code_bytes.clear();
-    m_object_code_bytes_start_of_word.clear();
-    
+    m_listing_control = Listing::Control::NONE;
+    m_word_starts = 0;
+    m_line_cacheable = true;
+    m_unresolved_operand = nullptr;
+
     try
     {
-      m_statement_sp = m_parser_sp->parse(m_pass_number,
-					  m_source_line_number,
-					  m_location_counter,
-					  m_source_line);
+      if (source_line.statement)
+      {
+	assemble_line();
+      }
+      else
+      {
+	fail_line(source_line, source_line.parse_error, source_line.parse_error_column);
+      }
+    }
+    catch (const AssemblerError& e)
+    {
+      fail_line(source_line, e.get_message());
     }
-    catch (const ParseError& parse_error)
+    catch (const SymbolTableError& e)
     {
-      std::cerr << std::format("line {} parse failed\n", m_source_line_number);
+      fail_line(source_line, e.what());
+    }
+    catch (const ValueUnknownError& e)
+    {
+      fail_line(source_line,
+		std::format("unknown symbols {}",
+			    m_symbol_table_sp->get_symbol_names(e.get_unknown_symbols())));
     }
 
-    assemble_line();
+    record_line(source_line);
+  }
+}
 
-    if (m_pass_number == 2)
+// A line with an error produces no object code, but keeps the space
+// that the sizing passes gave it, so that the lines after it stay at
+// the addresses their labels were given. A fixed-size line keeps its
+// size in every pass, as the sizing passes would have given it had it
+// not failed; any other line keeps, in the final pass, the size
+// recorded by the last sizing pass. Errors are only reported by the
+// final pass, since the sizing passes would report most of them again.
+void Assembler::fail_line(const SourceLine& source_line,
+			  const std::string& message,
+			  unsigned column)
+{
+  std::size_t index = m_source_line_number - 1;
+  m_object_code_pool->resize(m_line_start);
+  m_word_starts = 0;
+  m_line_cacheable = false;
+  while ((! m_fixups.empty()) && (m_fixups.back().line_index == index))
+  {
+    m_fixups.pop_back();  // nothing left to patch
+  }
+  if (source_line.fixed_size)
+  {
+    m_skipped_bytes = *source_line.fixed_size;
+  }
+  else if (m_final_pass && ! m_single_pass)
+  {
+    // the line table still holds the line's size from the last
+    // sizing pass
+    m_skipped_bytes = m_line_table_sp->get_length(index);
+  }
+  if (m_final_pass)
+  {
+    report(Severity::ERROR, m_source_line_number, message, column);
+  }
+}
+
+bool Assembler::can_replay(const SourceLine& source_line) const
+{
+  std::size_t index = m_source_line_number - 1;
+  if ((! (m_line_table_sp->get_flags(index) & LineTable::CACHED)) ||
+      (m_line_table_sp->get_address(index) != m_location_counter))
+  {
+    return false;
+  }
+  for (const ExpressionProgram& program: source_line.statement->get_operand_programs())
+  {
+    for (const ExpressionProgram::Instruction& instruction: program.get_code())
     {
-      write_listing_line(m_listing_file);
-      write_object_bytes();
+      if ((instruction.opcode == ExpressionProgram::Opcode::PUSH_SYMBOL) &&
+	  (m_symbol_table_sp->get_symbol_change_generation(instruction.operand) > source_line.cached_generation))
+      {
+	return false;
+      }
     }
-    m_location_counter += m_object_code_bytes.size();
   }
+  return true;
+}
+
+// The line's label, if any, is at the same address as before, so
+// doesn't need to be defined again. Its object code is copied from the
+// previous pass's pool to the current one.
+void Assembler::replay_line()
+{
+  std::size_t index = m_source_line_number - 1;
+  LineTable& line_table = *m_line_table_sp;
+  std::span<const std::uint8_t> object_code = line_table.get_previous_object_code(index);
+  m_object_code_pool->insert(m_object_code_pool->end(), object_code.begin(), object_code.end());
+  line_table.record(index,
+		    line_table.get_address(index),
+		    m_line_start,
+		    object_code.size(),
+		    line_table.get_word_starts(index),
+		    line_table.get_flags(index),
+		    line_table.get_listing_control(index));
+  ++m_replayed_lines;
+}
+
+std::size_t Assembler::get_line_size() const
+{
+  return m_object_code_pool->size() - m_line_start;
+}
 
-  if (m_pass_number == 2)
+void Assembler::record_line(SourceLine& source_line)
+{
+  // Only lines whose sole effect is to define a label and emit bytes
+  // can be replayed.
+  bool cacheable = m_statement && m_line_cacheable;
+  if (cacheable && (m_statement->get_mnemonic_kind() == MnemonicKind::PSEUDO_OP))
+  {
+    switch (m_statement->get_pseudo_op())
+    {
+    case PseudoOp::PseudoOpEnum::ASCII:
+    case PseudoOp::PseudoOpEnum::BYTE:
+    case PseudoOp::PseudoOpEnum::HBYTE:
+    case PseudoOp::PseudoOpEnum::WORD:
+      break;
+    default:
+      cacheable = false;
+      break;
+    }
+  }
+  std::uint8_t flags = 0;
+  if (m_listing_show_address)
   {
-    // XXX list_symbol_table(m_listing_file);
+    flags |= LineTable::SHOW_ADDRESS;
   }
+  if (cacheable)
+  {
+    flags |= LineTable::CACHED;
+    source_line.cached_generation = m_symbol_table_sp->get_generation();
+  }
+  m_line_table_sp->record(m_source_line_number - 1,
+			  m_object_code_address,
+			  m_line_start,
+			  get_line_size(),
+			  m_word_starts,
+			  flags,
+			  m_listing_control);
+}
 
-  std::cerr << std::format("Pass {}: detected {} errors, {} warnings\n",
-			   m_pass_number, m_error_count, m_warning_count);
+// Parse errors are reported by the caller, in line order.
+bool Assembler::parse_source_line(std::size_t index,
+				  Parser& parser)
+{
+  SourceLine& source_line = m_source_lines[index];
+  source_line.text = m_source_buffer_sp->get_line(index);
+  try
+  {
+    source_line.statement = parser.parse(index + 1, source_line.text);
+  }
+  catch (const ParseError& parse_error)
+  {
+    source_line.statement = nullptr;
+    source_line.parse_error = parse_error.what();
+    source_line.parse_error_column = parse_error.get_column();
+  }
+  source_line.fixed_size = get_fixed_size(source_line.statement);
+  return source_line.statement;
 }
 
-void Assembler::define_symbol(const std::string& symbol,
-			      ValueSP value)
+// Each chunk of lines is parsed by its own parser into its own arena,
+// interning symbols in its own symbol table, so the chunks share
+// nothing. The chunk symbol tables are then merged into the real one
+// in chunk order, which assigns every symbol the same ID that a serial
+// parse would have. Lines after an .end statement are parsed too, but
+// never assembled.
+void Assembler::parse_source_lines_parallel()
 {
-  m_symbol_table_sp->define_symbol(m_source_line_number, symbol, value);
+  struct Chunk
+  {
+    std::size_t begin;
+    std::size_t end;
+    std::shared_ptr<SymbolTable> symbol_table_sp;
+    std::future<void> done;
+  };
+
+  std::size_t line_count = m_source_lines.size();
+  std::size_t chunk_count = std::max<std::size_t>(1, std::min<std::size_t>(m_jobs, line_count));
+  std::vector<Chunk> chunks(chunk_count);
+  for (std::size_t i = 0; i < chunk_count; i++)
+  {
+    Chunk& chunk = chunks[i];
+    chunk.begin = (i * line_count) / chunk_count;
+    chunk.end = ((i + 1) * line_count) / chunk_count;
+    chunk.symbol_table_sp = SymbolTable::create();
+    m_chunk_ast_arena_sps.push_back(ASTArena::create());
+    std::shared_ptr<Parser> parser_sp = Parser::create(m_instruction_set_sp,
+						       chunk.symbol_table_sp,
+						       m_chunk_ast_arena_sps.back());
+    chunk.done = std::async(std::launch::async,
+			    [this, parser_sp, begin = chunk.begin, end = chunk.end] ()
+			    {
+			      for (std::size_t index = begin; index < end; index++)
+			      {
+				parse_source_line(index, *parser_sp);
+			      }
+			    });
+  }
+  for (Chunk& chunk: chunks)
+  {
+    chunk.done.wait();
+  }
+
+  std::vector<SymbolId> symbols;  // chunk SymbolId to real SymbolId
+  for (Chunk& chunk: chunks)
+  {
+    chunk.done.get();
+    const SymbolTable& chunk_symbol_table = *chunk.symbol_table_sp;
+    symbols.clear();
+    for (SymbolId symbol = 0; symbol < chunk_symbol_table.size(); symbol++)
+    {
+      symbols.push_back(m_symbol_table_sp->intern(chunk_symbol_table.get_symbol_name(symbol)));
+    }
+    for (std::size_t index = chunk.begin; index < chunk.end; index++)
+    {
+      if (Statement* statement = m_source_lines[index].statement)
+      {
+	statement->remap_symbols(symbols);
+      }
+    }
+  }
 }
 
-void Assembler::assemble_line()
+// The size of most statements is known without evaluating their
+// operands: those with no instruction, instructions with only one
+// addressing mode, and the data pseudo-ops. Statements that would be
+// rejected by the assembler aren't considered fixed size, but are
+// assembled normally, so that the final pass reports the error.
+std::optional<std::uint16_t> Assembler::get_fixed_size(const Statement* statement)
 {
-  std::string mnemonic = m_statement_sp->get_mnemonic();
-  if ((! mnemonic.size()) ||
-      (m_instruction_set_sp->valid_mnemonic(mnemonic)))
+  if (! statement)
   {
-    assemble_instruction();
+    return std::nullopt;
   }
-  else if (PseudoOp::valid_mnemonic(mnemonic))
+  std::size_t operand_count = statement->get_operand_count();
+  switch (statement->get_mnemonic_kind())
   {
-    assemble_pseudo_op();
+  case MnemonicKind::NONE:
+    return 0;
+  case MnemonicKind::UNRECOGNIZED:
+    return std::nullopt;
+  case MnemonicKind::INSTRUCTION:
+    {
+      std::span<const InstructionSet::Info> infos = statement->get_instruction_infos();
+      if (infos.size() != 1)
+      {
+	return std::nullopt;  // zero page or absolute, depending on the operand value
+      }
+      std::size_t operand_size = InstructionSet::operand_size_bytes(infos[0].mode);
+      if (operand_count != (operand_size ? 1 : 0))
+      {
+	return std::nullopt;
+      }
+      return 1 + operand_size;
+    }
+  case MnemonicKind::PSEUDO_OP:
+    break;
   }
-  else
+
+  const PseudoOp::Info& pseudo_op_info = PseudoOp::get_info(statement->get_pseudo_op());
+  if (statement->has_label() &&
+      (pseudo_op_info.flags[PseudoOp::Flag::LABEL_DISALLOWED] ||
+       pseudo_op_info.flags[PseudoOp::Flag::LABEL_ISNT_LOC]))
+  {
+    return std::nullopt;
+  }
+  switch (pseudo_op_info.pseudo_op)
+  {
+  case PseudoOp::PseudoOpEnum::ASCII:
+    if ((operand_count != 1) || ! StringConstant::classof(statement->get_operand(0)))
+    {
+      return std::nullopt;
+    }
+    return node_cast<StringConstant>(statement->get_operand(0))->get().size();
+  case PseudoOp::PseudoOpEnum::BYTE:
+  case PseudoOp::PseudoOpEnum::HBYTE:
+    return std::max<std::size_t>(1, operand_count);
+  case PseudoOp::PseudoOpEnum::WORD:
+    return 2 * std::max<std::size_t>(1, operand_count);
+  case PseudoOp::PseudoOpEnum::LIST:
+  case PseudoOp::PseudoOpEnum::NOLIST:
+  case PseudoOp::PseudoOpEnum::PAGE:
+    return 0;
+  default:
+    return std::nullopt;
+  }
+}
+
+void Assembler::define_symbol(SymbolId symbol,
+			      Value value)
+{
+  try
+  {
+    if (m_symbols_frozen)
+    {
+      m_symbol_table_sp->verify_symbol(m_source_line_number, symbol, value);
+    }
+    else if (m_symbol_table_sp->define_symbol(m_source_line_number, symbol, value))
+    {
+      ++m_symbols_changed;
+    }
+  }
+  catch (const SymbolValueRedefined& e)
+  {
+    // only possible in the final pass, after the addresses converged
+    throw AssemblerError(m_source_line_number, std::format("phase error: {}", e.what()));
+  }
+}
+
+void Assembler::assemble_line()
+{
+  if (! m_statement)
+  {
+    throw AssemblerError(m_source_line_number, "syntax error");
+  }
+
+  // the mnemonic was resolved by the parser
+  switch (m_statement->get_mnemonic_kind())
   {
-    throw AssemblerError(m_source_line_number, std::format("Unrecognized mnemonic \"{}\"", mnemonic));
+  case MnemonicKind::NONE:
+  case MnemonicKind::INSTRUCTION:
+    assemble_instruction();
+    break;
+  case MnemonicKind::PSEUDO_OP:
+    assemble_pseudo_op();
+    break;
+  case MnemonicKind::UNRECOGNIZED:
+    throw AssemblerError(m_source_line_number,
+			 std::format("Unrecognized mnemonic \"{}\"", m_statement->get_mnemonic()));
   }
 }
 
 void Assembler::assemble_instruction()
 {
-  std::string label = m_statement_sp->get_label();
-  if (label.size())
+  if (m_statement->has_label())
   {
-    define_symbol(label,
-		  Value::create(m_location_counter));
+    define_symbol(m_statement->get_label(),
+		  Value(m_location_counter));
   }
 
-  std::string mnemonic = m_statement_sp->get_mnemonic();
-  if (! mnemonic.size())
+  if (m_statement->get_mnemonic_kind() == MnemonicKind::NONE)
   {
     return;  // no instruction, just a label
   }
+  std::string_view mnemonic = m_statement->get_mnemonic();
 
   // At most, infos will have two entries, for corresponding zero page and absolute (possibly indexed) statements.
-  const std::vector<InstructionSet::Info>& infos = m_instruction_set_sp->get(mnemonic);
+  std::span<const InstructionSet::Info> infos = m_statement->get_instruction_infos();
   bool expect_operand = false;
   switch (infos.size())
   {
@@ -242,7 +1110,7 @@ void Assembler::assemble_instruction()
   default:
     throw std::logic_error(std::format("internal error: instruction with {} modes", infos.size()));
   }
-  std::size_t operand_count = m_statement_sp->get_operand_count();
+  std::size_t operand_count = m_statement->get_operand_count();
   if (operand_count != expect_operand)
   {
     throw AssemblerError(m_source_line_number,
@@ -252,6 +1120,7 @@ void Assembler::assemble_instruction()
 				     operand_count));
   }
   bool found = false;
+  bool relative = false;
   std::uint8_t opcode;
   std::uint16_t operand_value;
   std::size_t operand_size = 0;
@@ -262,23 +1131,27 @@ void Assembler::assemble_instruction()
   }
   else
   {
-    auto expression_sp = m_statement_sp->get_operand(0);
-    operand_value = convert_operand_uint16(expression_sp);
+    operand_value = convert_operand_uint16(m_statement->get_operand_program(0));
     operand_size = (operand_value > 0x00ff) ? 2 : 1;
     for (const auto& info: infos)
     {
       if (info.mode == InstructionSet::Mode::RELATIVE)
       {
 	found = true;
+	relative = true;
 	operand_size = 1;
 	std::int32_t displacement = operand_value - (m_location_counter + 2);
-	if ((m_pass_number == 2) &&
+	if ((! m_unresolved_operand) &&
 	    ((displacement < std::numeric_limits<std::int8_t>::min()) ||
 	     (displacement > std::numeric_limits<std::int8_t>::max())))
 	{
-	  throw AssemblerError(m_source_line_number,
-			       std::format("relative branch displacement {} out of range",
-					   displacement));
+	  if (m_final_pass)
+	  {
+	    throw AssemblerError(m_source_line_number,
+				 std::format("relative branch displacement {} out of range",
+					     displacement));
+	  }
+	  m_line_cacheable = false;  // must be checked again in the final pass
 	}
 	opcode = info.opcode;
 	operand_value = displacement & 0xff;
@@ -300,6 +1173,13 @@ void Assembler::assemble_instruction()
 				       operand_size,
 				       operand_value));
     }
+    if (m_unresolved_operand && (infos.size() == 2))
+    {
+      report(Severity::WARNING,
+	     m_source_line_number,
+	     std::format("forward reference in single-pass mode, \"{}\" assembled with absolute operand",
+			 mnemonic));
+    }
   }
   emit_byte(opcode);
   switch (operand_size)
@@ -307,21 +1187,19 @@ void Assembler::assemble_instruction()
   case 0:
     break;
   case 1:
-    emit_byte(operand_value);
+    emit_operand(relative ? Fixup::Kind::RELATIVE : Fixup::Kind::LOW_BYTE, operand_value);
     break;
   case 2:
-    emit_word(operand_value);
+    emit_operand(Fixup::Kind::ABSOLUTE, operand_value);
     break;
   }
 }
 
 void Assembler::assemble_pseudo_op()
 {
-  std::string mnemonic = m_statement_sp->get_mnemonic();
-  const PseudoOp::Info& pseudo_op_info = PseudoOp::lookup_mnemonic(mnemonic);
+  const PseudoOp::Info& pseudo_op_info = PseudoOp::get_info(m_statement->get_pseudo_op());
 
-  std::string label = m_statement_sp->get_label();
-  if (label.size())
+  if (m_statement->has_label())
   {
     if (pseudo_op_info.flags[PseudoOp::Flag::LABEL_DISALLOWED])
     {
@@ -330,99 +1208,199 @@ void Assembler::assemble_pseudo_op()
     }
     if (! pseudo_op_info.flags[PseudoOp::Flag::LABEL_ISNT_LOC])
     {
-      define_symbol(label, Value::create(m_location_counter));
+      define_symbol(m_statement->get_label(), Value(m_location_counter));
     }
   }
   (this->*s_assemble_pseudo_op_fn_ptrs[pseudo_op_info.pseudo_op])(pseudo_op_info);
 }
 
-void Assembler::write_object_bytes()
+
+// References are collected from the compiled operands of the lines
+// once the final pass is complete, so that neither the parallel final
+// pass nor replayed lines have to record them. The symbol that .DEF
+// defines is an operand, but not a reference.
+void Assembler::collect_cross_references()
 {
-  if (! m_object_code_bytes.size())
-  {
-    return;
-  }
-  if (m_object_code_address != m_prev_object_code_address)
+  CrossReference& cross_reference = *m_cross_reference_sp;
+  cross_reference.clear();
+  for (std::size_t index = 0; index < m_source_lines_assembled; index++)
   {
-    m_object_file << std::format("*{:04X}", m_object_code_address);
+    const Statement* statement = m_source_lines[index].statement;
+    if (! statement)
+    {
+      continue;
+    }
+    std::span<const ExpressionProgram> programs = statement->get_operand_programs();
+    if ((statement->get_mnemonic_kind() == MnemonicKind::PSEUDO_OP) &&
+	(statement->get_pseudo_op() == PseudoOp::PseudoOpEnum::DEF) &&
+	programs.size())
+    {
+      programs = programs.subspan(1);
+    }
+    for (const ExpressionProgram& program: programs)
+    {
+      for (const ExpressionProgram::Instruction& instruction: program.get_code())
+      {
+	if (instruction.opcode == ExpressionProgram::Opcode::PUSH_SYMBOL)
+	{
+	  cross_reference.add(instruction.operand, index + 1);
+	}
+      }
+    }
   }
-  for (std::size_t i = 0; i < m_object_code_bytes.size(); i++)
+  cross_reference.sort(m_symbol_table_sp->size());
+}
+
+// The symbol table follows the source lines in the listing, sorted by
+// name and then by value. Symbols that are neither defined nor
+// referenced, e.g., from lines after .END, are omitted.
+void Assembler::list_symbol_table()
+{
+  collect_cross_references();
+
+  const SymbolTable& symbol_table = *m_symbol_table_sp;
+  std::vector<SymbolId> symbols;
+  symbols.reserve(symbol_table.size());
+  std::size_t name_width = 8;
+  for (SymbolId symbol = 0; symbol < symbol_table.size(); symbol++)
   {
-    m_object_file << std::format("{:02X}", m_object_code_bytes[i]);
+    if (symbol_table.contains(symbol) ||
+	m_cross_reference_sp->get_reference_line_numbers(symbol).size())
+    {
+      symbols.push_back(symbol);
+      name_width = std::max(name_width, symbol_table.get_symbol_name(symbol).size());
+    }
   }
-  m_object_code_address += m_object_code_bytes.size();
-  m_prev_object_code_address = m_object_code_address;
-}
 
+  std::ranges::sort(symbols,
+		    [&symbol_table](SymbolId a, SymbolId b)
+		    {
+		      return symbol_table.get_symbol_name(a) < symbol_table.get_symbol_name(b);
+		    });
+  list_symbols("symbols by name", symbols, name_width);
 
-void Assembler::write_listing_line(std::ostream& os)
+  // undefined symbols have no value to sort by; the stable sort keeps
+  // symbols of equal value in name order
+  std::erase_if(symbols,
+		[&symbol_table](SymbolId symbol)
+		{
+		  return ! symbol_table.contains(symbol);
+		});
+  std::ranges::stable_sort(symbols,
+			   [&symbol_table](SymbolId a, SymbolId b)
+			   {
+			     return symbol_table.get_symbol_value(a).get() < symbol_table.get_symbol_value(b).get();
+			   });
+  list_symbols("symbols by value", symbols, name_width);
+}
+
+// Each symbol is listed with its value, the line defining it, and the
+// lines referring to it, which continue on further lines as needed.
+void Assembler::list_symbols(std::string_view title,
+			     std::span<const SymbolId> symbols,
+			     std::size_t name_width)
 {
-  std::string line = std::format("{:-5}  ", m_source_line_number);
+  static constexpr std::size_t REFERENCES_PER_LINE = 10;
 
-  if (m_listing_show_address || m_object_code_bytes.size())
+  Listing& listing = *m_listing_sp;
+  const SymbolTable& symbol_table = *m_symbol_table_sp;
+  if (m_listing_page_length)
   {
-    line += std::format("{:04x} ", m_object_code_address);
+    listing.new_page();
   }
   else
   {
-    line += "     ";
+    listing.list_text("");
   }
+  listing.list_text(title);
+  listing.list_text("");
+  listing.list_text(std::format("{:<{}}  value    def  references", "symbol", name_width));
 
-  std::string s_obj;
-  std::size_t i = 0;
-  while ((i < MAX_OBJECT_BYTES_PER_LISTING_LINE) && (i < m_object_code_bytes.size()))
+  std::string text;
+  for (SymbolId symbol: symbols)
   {
-    if (m_object_code_bytes_start_of_word[i])
+    text.clear();
+    std::format_to(std::back_inserter(text), "{:<{}}  ", symbol_table.get_symbol_name(symbol), name_width);
+    if (symbol_table.contains(symbol))
     {
-      s_obj += std::format(" {:04x}", (m_object_code_bytes[i+1] << 8) | m_object_code_bytes[i]);
-      i += 2;
+      std::format_to(std::back_inserter(text),
+		     "{:04x}   {:>5}",
+		     symbol_table.get_symbol_value(symbol).get(),
+		     symbol_table.get_symbol_definition_line(symbol));
     }
     else
     {
-      s_obj += std::format(" {:02x}", m_object_code_bytes[i]);
-      ++i;
+      text += "????        ";
+    }
+    std::span<const std::uint32_t> line_numbers = m_cross_reference_sp->get_reference_line_numbers(symbol);
+    for (std::size_t i = 0; i < line_numbers.size(); i++)
+    {
+      if (i && ! (i % REFERENCES_PER_LINE))
+      {
+	listing.list_text(text);
+	text.assign(name_width + 2 + 12, ' ');
+      }
+      std::format_to(std::back_inserter(text), " {:>5}", line_numbers[i]);
     }
+    listing.list_text(text);
   }
-  s_obj += std::string(9 - s_obj.size(), ' ');
-  line += s_obj;
-
-  line += "  " + m_source_line + '\n';
-  os << line;
 }
 
 
-void Assembler::list_symbol_table(std::ostream& os)
+void Assembler::emit_byte(std::uint8_t byte)
+{
+  m_object_code_pool->push_back(byte);
+}
+
+void Assembler::emit_word(std::uint16_t word)
 {
-  (void) os;
-#if 0
-  os << "\n";
-  os << "symbol    value   def    referenced\n";
-  os << "--------  ------  -----  ----------\n";
-  for (const auto& [symbol, entry]: m_symbol_table_sp)
+  std::size_t offset = get_line_size();
+  if (offset < LineTable::WORD_START_BYTES)
   {
-    os << std::format("{:8}  {:06x}  {:5}", symbol, entry.value, entry.definition_line);
-    for (const auto& line_number: entry.reference_lines)
-    {
-      os << std::format("  {:5}", line_number);
-    }
-    os << "\n";
+    m_word_starts |= std::uint32_t(1) << offset;
   }
-#endif
+  m_object_code_pool->push_back(word & 0xff);
+  m_object_code_pool->push_back(word >> 8);
 }
 
-
-void Assembler::emit_byte(std::uint8_t byte)
+// In single-pass mode, an operand that convert_operand_uint16() couldn't
+// resolve is emitted as zero, and a fixup is recorded to patch it.
+void Assembler::emit_operand(Fixup::Kind kind,
+			     std::uint16_t value)
 {
-  m_object_code_bytes.push_back(byte);
-  m_object_code_bytes_start_of_word.push_back(false);
+  if (m_unresolved_operand)
+  {
+    m_fixups.push_back(Fixup { .line_index         = m_source_line_number - 1,
+			       .offset             = get_line_size(),
+			       .kind               = kind,
+			       .program            = m_unresolved_operand,
+			       .source_line_number = m_source_line_number,
+			       .location_counter   = m_location_counter });
+    m_unresolved_operand = nullptr;
+    value = 0;
+  }
+  switch (kind)
+  {
+  case Fixup::Kind::ABSOLUTE:
+    emit_word(value);
+    break;
+  case Fixup::Kind::LOW_BYTE:
+  case Fixup::Kind::RELATIVE:
+    emit_byte(static_cast<std::uint8_t>(value & 0xff));
+    break;
+  case Fixup::Kind::HIGH_BYTE:
+    emit_byte(static_cast<std::uint8_t>(value >> 8));
+    break;
+  }
 }
 
-void Assembler::emit_word(std::uint16_t word)
+void Assembler::reject_unresolved_operand()
 {
-  m_object_code_bytes.push_back(word & 0xff);
-  m_object_code_bytes_start_of_word.push_back(true);
-  m_object_code_bytes.push_back(word >> 8);
-  m_object_code_bytes_start_of_word.push_back(false);
+  if (m_unresolved_operand)
+  {
+    throw AssemblerError(m_source_line_number,
+			 "forward reference not allowed in single-pass mode");
+  }
 }
 
 void Assembler::assemble_pseudo_op_unimplemented([[maybe_unused]] const PseudoOp::Info& pseudo_op_info)
@@ -433,9 +1411,8 @@ void Assembler::assemble_pseudo_op_unimplemented([[maybe_unused]] const PseudoOp
 
 void Assembler::assemble_pseudo_op_ascii([[maybe_unused]] const PseudoOp::Info& pseudo_op_info)
 {
-  auto operand_sp = m_statement_sp->get_operand(0);
-  StringConstantSP string_sp = dynamic_pointer_cast<StringConstant>(operand_sp);
-  const std::string& string = string_sp->get();
+  auto string_constant = node_cast<StringConstant>(m_statement->get_operand(0));
+  std::string_view string = string_constant->get();
   for (auto c: string)
   {
     std::uint8_t byte = static_cast<std::uint8_t>(c);
@@ -445,27 +1422,27 @@ void Assembler::assemble_pseudo_op_ascii([[maybe_unused]] const PseudoOp::Info&
 
 void Assembler::assemble_pseudo_op_byte([[maybe_unused]] const PseudoOp::Info& pseudo_op_info)
 {
-  if (! m_statement_sp->get_operand_count())
+  if (! m_statement->get_operand_count())
   {
     emit_byte(0);
   }
   else
   {
-    for (const auto& expression_sp: m_statement_sp->get_operands())
+    for (const auto& program: m_statement->get_operand_programs())
     {
       // ASM65 silently truncates .BYTE operands to low byte
-      std::uint16_t value = convert_operand_uint16(expression_sp);
-      emit_byte(static_cast<std::uint8_t>(value & 0xff));
+      std::uint16_t value = convert_operand_uint16(program);
+      emit_operand(Fixup::Kind::LOW_BYTE, value);
     }
   }
 }
 
 void Assembler::assemble_pseudo_op_def([[maybe_unused]] const PseudoOp::Info& pseudo_op_info)
 {
-  auto operand_sp = m_statement_sp->get_operand(0);
-  auto symbol_sp = dynamic_pointer_cast<Symbol>(operand_sp);
-  std::uint16_t value = convert_operand_uint16(m_statement_sp->get_operand(1));
-  define_symbol(symbol_sp->get(), Value::create(value));
+  auto symbol = node_cast<Symbol>(m_statement->get_operand(0));
+  std::uint16_t value = convert_operand_uint16(m_statement->get_operand_program(1));
+  reject_unresolved_operand();
+  define_symbol(symbol->get(), Value(value));
   m_listing_show_address = true;
   m_object_code_address = value;
 }
@@ -477,28 +1454,29 @@ void Assembler::assemble_pseudo_op_end([[maybe_unused]] const PseudoOp::Info& ps
 
 void Assembler::assemble_pseudo_op_hbyte([[maybe_unused]] const PseudoOp::Info& pseudo_op_info)
 {
-  if (! m_statement_sp->get_operand_count())
+  if (! m_statement->get_operand_count())
   {
     emit_byte(0);
   }
   else
   {
-    for (const auto& expression_sp: m_statement_sp->get_operands())
+    for (const auto& program: m_statement->get_operand_programs())
     {
-      std::uint16_t value = convert_operand_uint16(expression_sp);
-      emit_byte(static_cast<std::uint8_t>(value >> 8));
+      std::uint16_t value = convert_operand_uint16(program);
+      emit_operand(Fixup::Kind::HIGH_BYTE, value);
     }
   }
 }
 
 void Assembler::assemble_pseudo_op_list([[maybe_unused]] const PseudoOp::Info& pseudo_op_info)
 {
-  // XXX ignore for now, but should affect listing output
+  m_listing_control = Listing::Control::LIST;
 }
 
 void Assembler::assemble_pseudo_op_loc([[maybe_unused]] const PseudoOp::Info& pseudo_op_info)
 {
-  std::uint16_t addr = convert_operand_uint16(m_statement_sp->get_operand(0));
+  std::uint16_t addr = convert_operand_uint16(m_statement->get_operand_program(0));
+  reject_unresolved_operand();
   m_location_counter = addr;
   m_object_code_address = addr;
   m_listing_show_address = true;
@@ -506,27 +1484,27 @@ void Assembler::assemble_pseudo_op_loc([[maybe_unused]] const PseudoOp::Info& ps
 
 void Assembler::assemble_pseudo_op_nolist([[maybe_unused]] const PseudoOp::Info& pseudo_op_info)
 {
-  // XXX ignore for now, but should affect listing output
+  m_listing_control = Listing::Control::NOLIST;
 }
 
 void Assembler::assemble_pseudo_op_page([[maybe_unused]] const PseudoOp::Info& pseudo_op_info)
 {
-  // XXX ignore for now, but should affect listing output
+  m_listing_control = Listing::Control::PAGE;
 }
 
 void Assembler::assemble_pseudo_op_word([[maybe_unused]] const PseudoOp::Info& pseudo_op_info)
 {
-  if (! m_statement_sp->get_operand_count())
+  if (! m_statement->get_operand_count())
   {
     emit_word(0);
   }
   else
   {
-    for (const auto& expression_sp: m_statement_sp->get_operands())
+    for (const auto& program: m_statement->get_operand_programs())
     {
       // ASM65 silently truncates .BYTE operands to low byte
-      std::uint16_t value = convert_operand_uint16(expression_sp);
-      emit_word(value);
+      std::uint16_t value = convert_operand_uint16(program);
+      emit_operand(Fixup::Kind::ABSOLUTE, value);
     }
   }
 }
@@ -7,15 +7,27 @@
 #define ASSEMBLER_HH
 
 #include <array>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "ast_node.hh"
+#include "cross_reference.hh"
+#include "diagnostic.hh"
 #include "instruction_set.hh"
+#include "line_table.hh"
+#include "listing.hh"
+#include "listing_writer.hh"
+#include "memory_image.hh"
+#include "object_format.hh"
 #include "parser.hh"
 #include "pseudo_op.hh"
+#include "source_buffer.hh"
 #include "symbol_table.hh"
 #include "value.hh"
 
@@ -24,6 +36,13 @@ struct AssemblerError: public std::runtime_error
   AssemblerError(const std::string& what);
   AssemblerError(std::size_t source_line_number,
 		 const std::string& what);
+
+  const std::string& get_message() const;  // without the line number
+  std::size_t get_source_line_number() const;  // zero if none
+
+protected:
+  std::string m_message;
+  std::size_t m_source_line_number;
 };
 
 class Assembler
@@ -31,9 +50,12 @@ class Assembler
 public:
   using Address = std::uint16_t;
 
-  Assembler(std::filesystem::path source_filename,
-	    std::filesystem::path object_filename,
-	    std::filesystem::path listing_filename);
+  // The instruction set and pseudo-op tables are read only, and may be
+  // shared by any number of assemblers, including concurrent ones.
+  // No output files are written unless they are added.
+  Assembler(std::shared_ptr<InstructionSet> instruction_set_sp,
+	    std::shared_ptr<PseudoOp> pseudo_op_sp,
+	    std::filesystem::path source_filename);
   virtual ~Assembler();
 
   Assembler           (const Assembler& ) = delete;  // no copy constructor
@@ -41,26 +63,173 @@ public:
   Assembler& operator=(const Assembler& ) = delete;  // no copy assignment
   Assembler& operator=(      Assembler&&) = delete;  // no move assignment
 
+  // Single-pass mode reads and assembles each line once. An operand
+  // that is still a forward reference is emitted as a placeholder and
+  // recorded as a fixup, and the fixups are patched at the end of the
+  // source, before the object code and listing are written.
+  void set_single_pass(bool single_pass);
+
+  // Check-only mode assembles as usual, and reports the same errors
+  // and warnings, but writes no listing or object code.
+  void set_check_only(bool check_only);
+
+  // With more than one job, the source is parsed in chunks of lines
+  // concurrently, and the final pass is split into chunks of lines
+  // that are assembled concurrently, since by then every label address
+  // is fixed and the symbol table is only read. The output is
+  // identical to that of a serial assembly. Zero means one job per
+  // hardware thread. The single pass of single-pass mode is always
+  // serial, though its source is still parsed concurrently.
+  void set_jobs(unsigned jobs);
+
+  // The object code is written in each format added, once assembly is
+  // complete. The fill byte is used for gaps in binary formats, and
+  // defaults to $FF.
+  void add_object_file(ObjectFormat format,
+		       std::filesystem::path filename);
+  void set_fill_byte(std::uint8_t fill_byte);
+
+  void set_listing_file(std::filesystem::path filename);
+
+  // Lines per listing page, including the page header; zero disables
+  // pagination.
+  void set_listing_page_length(unsigned page_length);
+
+  // With a writer thread, the listing is formatted and written as the
+  // final pass runs, from lines queued by the assembling thread. If
+  // the queue is full, the assembling thread carries on, and queues
+  // the lines later. Only a serial, multi-pass final pass is
+  // pipelined; otherwise the listing is written after the pass.
+  void set_writer_thread(bool writer_thread);
+
+  // Errors and warnings are reported to the sink, in line order, once
+  // the final pass is complete. A line with an error produces no
+  // object code, and assembly continues. By default the diagnostics are buffered by the
+  // assembler, and can be retrieved with get_diagnostic_sink().
+  void set_diagnostic_sink(std::shared_ptr<DiagnosticSink> diagnostic_sink_sp);
+  std::shared_ptr<DiagnosticSink> get_diagnostic_sink() const;
+
   void assemble();
 
+  // The assembler reports errors and warnings itself, but leaves
+  // reporting progress and statistics to the caller.
+  struct PassStatistics
+  {
+    int pass_number;
+    bool final_pass;
+    std::size_t line_count;
+    std::size_t replayed_line_count;
+    std::size_t fixed_size_line_count;
+    std::size_t byte_count;
+    unsigned symbols_changed;
+    unsigned forward_references;
+    unsigned error_count;
+    unsigned warning_count;
+    std::size_t chunk_count;  // of a parallel final pass, otherwise 1
+    std::size_t fixup_count;  // of single-pass mode, otherwise 0
+    std::chrono::duration<double> elapsed;
+  };
+
+  const std::vector<PassStatistics>& get_pass_statistics() const;
+
+  // The object code of the final pass. The object file is rendered
+  // from it once the final pass is complete.
+  std::shared_ptr<const MemoryImage> get_memory_image() const;
+
+  // The output of every line, from the final pass, for tools that
+  // need more than the memory image.
+  std::shared_ptr<const LineTable> get_line_table() const;
+
 private:
   using AssembleInstructionFnPtr = void (Assembler::*) (const InstructionSet::Info& instruction_info);
   using AssemblePseudoOpFnPtr    = void (Assembler::*) (const PseudoOp::Info& pseudo_op_info);
 
-  void assemble_pass(int pass_number);
+  // Sizing passes are repeated until no label moves, so that forward
+  // references get the smallest legal encoding; the final pass then
+  // generates the object code and listing.
+  static constexpr int MAX_SIZING_PASSES = 16;
+
+  // worker for a parallel final pass; shares the parent's tables, but
+  // has its own line state and doesn't open any files
+  explicit Assembler(const Assembler* parent);
+
+  void start_pass(int pass_number,
+		  bool final_pass);
+  void finish_pass();
+
+  void assemble_pass(int pass_number,
+		     bool final_pass);
+
+  void assemble_final_pass_parallel(int pass_number);
+
+  void assemble_passes();
+  void assemble_single_pass();
+
+  struct Fixup
+  {
+    enum class Kind
+    {
+      ABSOLUTE,   // word
+      LOW_BYTE,
+      HIGH_BYTE,
+      RELATIVE,   // branch displacement
+    };
+
+    std::size_t line_index;
+    std::size_t offset;                  // of the operand in the line's object code
+    Kind kind;
+    const ExpressionProgram* program;
+    unsigned source_line_number;
+    std::uint16_t location_counter;      // at the start of the line
+  };
+
+  void emit_operand(Fixup::Kind kind,
+		    std::uint16_t value);
+  void reject_unresolved_operand();
+  void apply_fixups();
+
+  void build_memory_image();
+  void write_object_files();
+  void write_listing();
+  Listing::Line make_listing_line(std::size_t index) const;
+  void queue_listing_lines(std::size_t end,
+			   bool wait);
+
+  bool parse_source_line(std::size_t index,
+			 Parser& parser);
+  void parse_source_lines_parallel();
+
+  static std::optional<std::uint16_t> get_fixed_size(const Statement* statement);
+
+  struct SourceLine;
+  bool define_fixed_size_label(SourceLine& source_line);
+  void assemble_source_line(SourceLine& source_line);
+  void assemble_final_lines(std::span<SourceLine> source_lines,
+			    std::size_t first_index);
+  void fail_line(const SourceLine& source_line,
+		 const std::string& message,
+		 unsigned column = 0);
+  bool can_replay(const SourceLine& source_line) const;
+  void replay_line();
+  void record_line(SourceLine& source_line);
+  std::size_t get_line_size() const;  // of the current line's object code
 
   void assemble_line();
   void assemble_instruction();
   void assemble_pseudo_op();
 
-  void write_listing_line(std::ostream& os);
+  void report(Severity severity,
+	      unsigned source_line_number,
+	      const std::string& message,
+	      unsigned column = 0);
 
-  ValueSP evaluate(ExpressionSP expression_sp) const;
+  ValueExpected<Value> evaluate(const ExpressionProgram& program) const;
+  ValueExpected<std::uint16_t> evaluate_uint16(const ExpressionProgram& program) const;
 
-  std::uint16_t convert_operand_uint16(ExpressionSP expression_sp);
+  std::uint16_t convert_operand_uint16(const ExpressionProgram& program);
 
-  void define_symbol(const std::string& symbol,
-		     ValueSP value);
+  void define_symbol(SymbolId symbol,
+		     Value value);
 
   void assemble_pseudo_op_unimplemented(const PseudoOp::Info& pseudo_op_info);
 
@@ -79,39 +248,110 @@ private:
   void emit_byte(std::uint8_t byte);
   void emit_word(std::uint16_t word);
 
-  void write_object_bytes();
 
-  void list_symbol_table(std::ostream& os);
+  void collect_cross_references();
+  void list_symbol_table();
+  void list_symbols(std::string_view title,
+		    std::span<const SymbolId> symbols,
+		    std::size_t name_width);
 
-  std::ifstream m_source_file;
-  std::ofstream m_object_file;
+  // Members have default initializers, so that the main and worker
+  // constructors only set what differs.
+  std::string m_source_filename;
+  std::shared_ptr<SourceBuffer> m_source_buffer_sp;
+  std::shared_ptr<DiagnosticSink> m_diagnostic_sink_sp;
+  struct ObjectFile
+  {
+    ObjectFormat format;
+    std::ofstream file;
+  };
+  std::vector<ObjectFile> m_object_files;
+  std::uint8_t m_fill_byte = 0xff;
   std::ofstream m_listing_file;
+  std::shared_ptr<Listing> m_listing_sp;  // null if no listing file
+  std::shared_ptr<ListingWriter> m_listing_writer_sp;  // only during a pipelined final pass
+  std::size_t m_listing_queued_lines = 0;
+  bool m_writer_thread = false;
+  unsigned m_listing_page_length = Listing::DEFAULT_PAGE_LENGTH;
 
   std::shared_ptr<InstructionSet> m_instruction_set_sp;
   std::shared_ptr<PseudoOp> m_pseudo_op_sp;
   std::shared_ptr<SymbolTable> m_symbol_table_sp;
+  std::shared_ptr<ASTArena> m_ast_arena_sp;  // holds the AST of every source line
   std::shared_ptr<Parser> m_parser_sp;
+  std::shared_ptr<MemoryImage> m_memory_image_sp;
+  std::shared_ptr<LineTable> m_line_table_sp;
+  std::shared_ptr<CrossReference> m_cross_reference_sp;  // collected for the listing
+  std::vector<std::shared_ptr<ASTArena>> m_chunk_ast_arena_sps;  // from parallel parsing
+
+  int m_pass_number = 0;
+  bool m_final_pass = false;
+  bool m_single_pass = false;
+  bool m_check_only = false;
+  unsigned m_jobs = 1;
+  bool m_symbols_frozen = false;  // symbols are verified rather than defined
+  bool m_end_reached = false;
+  unsigned m_error_count = 0;
+  unsigned m_warning_count = 0;
+
+  // per-pass statistics
+  unsigned m_symbols_changed = 0;
+  unsigned m_forward_references = 0;
+  std::size_t m_byte_count = 0;
+  std::size_t m_replayed_lines = 0;
+  std::size_t m_fixed_size_lines = 0;
+  std::chrono::steady_clock::time_point m_pass_start_time;
+
+  std::vector<PassStatistics> m_pass_statistics;
+
+  unsigned m_source_line_number = 0;
+
+  // Source lines are parsed once, in pass 1. Later passes walk this
+  // table rather than reparsing the source.
+  //
+  // The output of each line from the last time it was assembled is
+  // recorded in the line table. If the line is cached, a later pass
+  // copies that output rather than reassembling the line, as long as
+  // the line is at the same address and no symbol it refers to has
+  // changed since. In single-pass mode, fixups are patched into the
+  // recorded output.
+  struct SourceLine
+  {
+    std::string_view text;     // view into the source buffer
+    Statement* statement;      // nullptr if the line failed to parse
+    std::string parse_error;   // the parser's message, if it failed
+    unsigned parse_error_column = 0;  // where it failed, if known
+
+    // If the size of the line is known from the statement alone, the
+    // sizing passes only define its label, if any.
+    std::optional<std::uint16_t> fixed_size;
+
+    std::uint16_t location_counter = 0;  // at the start of the line
 
-  int m_pass_number;
-  bool m_end_reached;
-  unsigned m_error_count;
-  unsigned m_warning_count;
+    std::uint64_t cached_generation = 0;  // symbol table generation, if cached
+  };
+  std::vector<SourceLine> m_source_lines;
+  std::size_t m_source_lines_assembled = 0;  // lines before and including .end
 
-  unsigned m_source_line_number;
-  std::string m_source_line;
+  std::vector<Fixup> m_fixups;
+  const ExpressionProgram* m_unresolved_operand = nullptr;  // set by convert_operand_uint16
 
-  std::uint16_t m_location_counter;
-  StatementSP m_statement_sp;
+  std::uint16_t m_location_counter = 0;
+  Statement* m_statement = nullptr;
+  bool m_line_cacheable = false;  // cleared if the current line's output isn't final
+  std::size_t m_skipped_bytes = 0;  // space kept for the current line, if it failed
 
-  // object code buffer
-  std::uint32_t m_prev_object_code_address;
-  std::uint32_t m_object_code_address;
-  std::vector<std::uint8_t> m_object_code_bytes;
-  std::vector<bool> m_object_code_bytes_start_of_word;
+  // Object code of the current line, which is appended to a pool: the
+  // line table's, or for a worker, the worker's own.
+  std::uint32_t m_object_code_address = 0;
+  std::vector<std::uint8_t>* m_object_code_pool = nullptr;
+  std::vector<std::uint8_t> m_worker_object_code_pool;
+  std::size_t m_line_start = 0;  // offset of the current line in the pool
+  std::uint32_t m_word_starts = 0;
 
   // listing
-  bool m_listing_show_address;  // forces showing address even if no object code bytes
-  static constexpr std::size_t MAX_OBJECT_BYTES_PER_LISTING_LINE = 3;
+  bool m_listing_show_address = false;  // forces showing address even if no object code bytes
+  Listing::Control m_listing_control = Listing::Control::NONE;
 
   static const magic_enum::containers::array<PseudoOp::PseudoOpEnum, AssemblePseudoOpFnPtr> s_assemble_pseudo_op_fn_ptrs;
 };
@@ -0,0 +1,45 @@
+// ast_arena.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "ast_arena.hh"
+
+std::shared_ptr<ASTArena> ASTArena::create()
+{
+  auto p = new ASTArena();
+  return std::shared_ptr<ASTArena>(p);
+}
+
+ASTArena::ASTArena():
+  m_resource(INITIAL_BLOCK_SIZE),
+  m_destructors(nullptr)
+{
+}
+
+ASTArena::~ASTArena()
+{
+  reset();
+}
+
+std::pmr::memory_resource* ASTArena::get_memory_resource()
+{
+  return &m_resource;
+}
+
+void ASTArena::register_destructor(void* object, void (*destructor)(void*))
+{
+  void* p = m_resource.allocate(sizeof(DestructorRecord), alignof(DestructorRecord));
+  m_destructors = new (p) DestructorRecord { destructor, object, m_destructors };
+}
+
+void ASTArena::reset()
+{
+  // destroy in reverse order of construction
+  for (DestructorRecord* record = m_destructors; record; record = record->next)
+  {
+    record->destructor(record->object);
+  }
+  m_destructors = nullptr;
+  m_resource.release();
+}
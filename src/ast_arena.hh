@@ -0,0 +1,70 @@
+// ast_arena.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef AST_ARENA_HH
+#define AST_ARENA_HH
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+
+// Bump allocator for AST nodes. Nodes are never freed individually;
+// reset() runs the destructors of all nodes that need one, then
+// releases all of the memory in one step. Nodes hold non-owning
+// pointers to other nodes in the same arena, and any containers in
+// nodes should allocate from get_memory_resource().
+class ASTArena
+{
+public:
+  static std::shared_ptr<ASTArena> create();
+  ~ASTArena();
+
+  ASTArena           (const ASTArena& ) = delete;  // no copy constructor
+  ASTArena           (      ASTArena& ) = delete;  // no move constructor
+  ASTArena& operator=(const ASTArena& ) = delete;  // no copy assignment
+  ASTArena& operator=(      ASTArena&&) = delete;  // no move assignment
+
+  // uninitialized storage suitable for a T
+  template <typename T>
+  void* allocate()
+  {
+    return m_resource.allocate(sizeof(T), alignof(T));
+  }
+
+  // take ownership of a node constructed in storage from allocate()
+  template <typename T>
+  T* own(T* node)
+  {
+    if constexpr (! std::is_trivially_destructible_v<T>)
+    {
+      register_destructor(node, [] (void* p) { static_cast<T*>(p)->~T(); });
+    }
+    return node;
+  }
+
+  std::pmr::memory_resource* get_memory_resource();
+
+  void reset();
+
+protected:
+  ASTArena();
+
+  void register_destructor(void* object, void (*destructor)(void*));
+
+  static constexpr std::size_t INITIAL_BLOCK_SIZE = 64 * 1024;
+
+  std::pmr::monotonic_buffer_resource m_resource;
+
+  struct DestructorRecord
+  {
+    void (*destructor)(void*);
+    void* object;
+    DestructorRecord* next;
+  };
+  DestructorRecord* m_destructors;  // most recently constructed first
+};
+
+#endif // AST_ARENA_HH
@@ -7,97 +7,209 @@
 
 #include "ast_node.hh"
 
-std::shared_ptr<Label> Label::create(const std::string& label)
+ASTNode::ASTNode(Kind kind):
+  m_kind(kind)
 {
-  auto p = new Label(label);
-  return std::shared_ptr<Label>(p);
 }
 
-const std::string& Label::get() const
+ASTNode::Kind ASTNode::get_kind() const
+{
+  return m_kind;
+}
+
+ASTNodeCastError::ASTNodeCastError(ASTNode::Kind kind):
+  std::logic_error(std::format("internal error: unexpected AST node kind {}",
+			       magic_enum::enum_name(kind)))
+{
+}
+
+Label* Label::create(ASTArena& arena, SymbolId label)
+{
+  return arena.own(new (arena.allocate<Label>()) Label(label));
+}
+
+bool Label::classof(const ASTNode* node)
+{
+  return node->get_kind() == Kind::LABEL;
+}
+
+SymbolId Label::get() const
 {
   return m_label;
 }
 
 std::string Label::debug_dump()
 {
-  return std::format("Label(\"{}\")", m_label);
+  return std::format("Label(#{})", m_label);
 }
 
-Label::Label(const std::string& label):
+Label::Label(SymbolId label):
+  ASTNode(Kind::LABEL),
   m_label(label)
 {
 }
 
-std::shared_ptr<Mnemonic> Mnemonic::create(const std::string& mnemonic)
+Mnemonic* Mnemonic::create(ASTArena& arena,
+			   std::string_view mnemonic,
+			   std::span<const InstructionSet::Info> instruction_infos)
+{
+  return arena.own(new (arena.allocate<Mnemonic>()) Mnemonic(mnemonic, instruction_infos));
+}
+
+Mnemonic* Mnemonic::create(ASTArena& arena,
+			   std::string_view mnemonic,
+			   PseudoOp::PseudoOpEnum pseudo_op)
 {
-  auto p = new Mnemonic(mnemonic);
-  return std::shared_ptr<Mnemonic>(p);
+  return arena.own(new (arena.allocate<Mnemonic>()) Mnemonic(mnemonic, pseudo_op));
 }
 
-const std::string& Mnemonic::get() const
+bool Mnemonic::classof(const ASTNode* node)
+{
+  return node->get_kind() == Kind::MNEMONIC;
+}
+
+std::string_view Mnemonic::get() const
 {
   return m_mnemonic;
 }
 
+MnemonicKind Mnemonic::get_mnemonic_kind() const
+{
+  return m_mnemonic_kind;
+}
+
+std::span<const InstructionSet::Info> Mnemonic::get_instruction_infos() const
+{
+  return m_instruction_infos;
+}
+
+PseudoOp::PseudoOpEnum Mnemonic::get_pseudo_op() const
+{
+  return m_pseudo_op;
+}
+
 std::string Mnemonic::debug_dump()
 {
   return std::format("Mnemonic(\"{}\")", m_mnemonic);
 }
 
-Mnemonic::Mnemonic(const std::string& mnemonic):
-  m_mnemonic(mnemonic)
+Mnemonic::Mnemonic(std::string_view mnemonic,
+		   std::span<const InstructionSet::Info> instruction_infos):
+  ASTNode(Kind::MNEMONIC),
+  m_mnemonic(mnemonic),
+  m_mnemonic_kind(instruction_infos.empty() ? MnemonicKind::UNRECOGNIZED : MnemonicKind::INSTRUCTION),
+  m_instruction_infos(instruction_infos),
+  m_pseudo_op()
+{
+}
+
+Mnemonic::Mnemonic(std::string_view mnemonic,
+		   PseudoOp::PseudoOpEnum pseudo_op):
+  ASTNode(Kind::MNEMONIC),
+  m_mnemonic(mnemonic),
+  m_mnemonic_kind(MnemonicKind::PSEUDO_OP),
+  m_pseudo_op(pseudo_op)
+{
+}
+
+Expression::Expression(Kind kind):
+  ASTNode(kind)
 {
 }
 
-std::shared_ptr<Constant> Constant::create(uint16_t value)
+bool Expression::classof(const ASTNode* node)
 {
-  auto p = new Constant(value);
-  return std::shared_ptr<Constant>(p);
+  return ((node->get_kind() >= Kind::CONSTANT) &&
+	  (node->get_kind() <= Kind::BINARY_OPERATOR_EXPRESSION));
 }
 
-std::shared_ptr<Constant> Constant::create(ValueSP value_sp)
+void Expression::remap_symbols([[maybe_unused]] std::span<const SymbolId> symbols)
 {
-  auto p = new Constant(value_sp);
-  return std::shared_ptr<Constant>(p);
 }
 
-ValueSP Constant::get() const
+Constant* Constant::create(ASTArena& arena, uint16_t value)
 {
-  return m_value_sp;
+  return arena.own(new (arena.allocate<Constant>()) Constant(value));
 }
 
-ValueSP Constant::evaluate([[maybe_unused]] ExpressionEvaluationContext& evaluation_context) const
+bool Constant::classof(const ASTNode* node)
 {
-  return m_value_sp;
+  return node->get_kind() == Kind::CONSTANT;
+}
+
+Constant* Constant::create(ASTArena& arena, Value value)
+{
+  return arena.own(new (arena.allocate<Constant>()) Constant(value));
+}
+
+Value Constant::get() const
+{
+  return m_value;
+}
+
+void Constant::compile(ExpressionProgram& program) const
+{
+  program.emit(ExpressionProgram::Opcode::PUSH_CONSTANT, m_value.get());
 }
 
 std::string Constant::debug_dump()
 {
-  return std::format("Constant({})", m_value_sp->get());
+  return std::format("Constant({})", m_value.get());
 }
 
 Constant::Constant(uint16_t value):
-  m_value_sp(Value::create(value))
+  Expression(Kind::CONSTANT),
+  m_value(value)
+{
+}
+
+Constant::Constant(Value value):
+  Expression(Kind::CONSTANT),
+  m_value(value)
+{
+}
+
+LocationCounter* LocationCounter::create(ASTArena& arena)
+{
+  return arena.own(new (arena.allocate<LocationCounter>()) LocationCounter());
+}
+
+bool LocationCounter::classof(const ASTNode* node)
+{
+  return node->get_kind() == Kind::LOCATION_COUNTER;
+}
+
+void LocationCounter::compile(ExpressionProgram& program) const
+{
+  program.emit(ExpressionProgram::Opcode::PUSH_LOCATION_COUNTER);
+}
+
+std::string LocationCounter::debug_dump()
 {
+  return std::format("LocationCounter");
 }
 
-Constant::Constant(ValueSP value_sp):
-  m_value_sp(value_sp)
+LocationCounter::LocationCounter():
+  Expression(Kind::LOCATION_COUNTER)
 {
 }
 
-std::shared_ptr<StringConstant> StringConstant::create(const std::string& string)
+StringConstant* StringConstant::create(ASTArena& arena, std::string_view string)
 {
-  auto p = new StringConstant(string);
-  return std::shared_ptr<StringConstant>(p);
+  return arena.own(new (arena.allocate<StringConstant>()) StringConstant(string));
 }
 
-const std::string& StringConstant::get() const
+bool StringConstant::classof(const ASTNode* node)
+{
+  return node->get_kind() == Kind::STRING_CONSTANT;
+}
+
+std::string_view StringConstant::get() const
 {
   return m_string;
 }
 
-ValueSP StringConstant::evaluate([[maybe_unused]] ExpressionEvaluationContext& evaluation_context) const
+void StringConstant::compile([[maybe_unused]] ExpressionProgram& program) const
 {
   throw std::logic_error("can't evaluate string constant");
 }
@@ -107,41 +219,56 @@ std::string StringConstant::debug_dump()
   return std::format("StringConstant('{}')", m_string);
 }
 
-StringConstant::StringConstant(const std::string& string):
+StringConstant::StringConstant(std::string_view string):
+  Expression(Kind::STRING_CONSTANT),
   m_string(string)
 {
 }
 
-std::shared_ptr<Symbol> Symbol::create(const std::string& symbol)
+Symbol* Symbol::create(ASTArena& arena, SymbolId symbol)
+{
+  return arena.own(new (arena.allocate<Symbol>()) Symbol(symbol));
+}
+
+bool Symbol::classof(const ASTNode* node)
 {
-  auto p = new Symbol(symbol);
-  return std::shared_ptr<Symbol>(p);
+  return node->get_kind() == Kind::SYMBOL;
 }
 
-const std::string& Symbol::get() const
+SymbolId Symbol::get() const
 {
   return m_symbol;
 }
 
-ValueSP Symbol::evaluate(ExpressionEvaluationContext& evaluation_context) const
+void Symbol::compile(ExpressionProgram& program) const
+{
+  program.emit(ExpressionProgram::Opcode::PUSH_SYMBOL, m_symbol);
+}
+
+void Symbol::remap_symbols(std::span<const SymbolId> symbols)
 {
-  return evaluation_context.symbol_table_sp->lookup_symbol(evaluation_context.source_line_number, m_symbol);
+  m_symbol = symbols[m_symbol];
 }
 
 std::string Symbol::debug_dump()
 {
-  return std::format("Symbol(\"{}\")", m_symbol);
+  return std::format("Symbol(#{})", m_symbol);
 }
 
-Symbol::Symbol(const std::string& symbol):
+Symbol::Symbol(SymbolId symbol):
+  Expression(Kind::SYMBOL),
   m_symbol(symbol)
 {
 }
 
-std::shared_ptr<UnaryOperator> UnaryOperator::create(UnaryOperatorEnum unary_operator)
+UnaryOperator* UnaryOperator::create(ASTArena& arena, UnaryOperatorEnum unary_operator)
 {
-  auto p = new UnaryOperator(unary_operator);
-  return std::shared_ptr<UnaryOperator>(p);
+  return arena.own(new (arena.allocate<UnaryOperator>()) UnaryOperator(unary_operator));
+}
+
+bool UnaryOperator::classof(const ASTNode* node)
+{
+  return node->get_kind() == Kind::UNARY_OPERATOR;
 }
 
 UnaryOperatorEnum UnaryOperator::get() const
@@ -167,31 +294,45 @@ std::string UnaryOperator::debug_dump()
 }
 
 UnaryOperator::UnaryOperator(UnaryOperatorEnum unary_operator):
+  ASTNode(Kind::UNARY_OPERATOR),
   m_unary_operator(unary_operator)
 {
 }
 
-std::shared_ptr<UnaryOperatorExpression> UnaryOperatorExpression::create(std::shared_ptr<UnaryOperator> unary_operator,
-									 std::shared_ptr<Expression> subexpression)
+UnaryOperatorExpression* UnaryOperatorExpression::create(ASTArena& arena,
+							 UnaryOperator* unary_operator,
+							 Expression* subexpression)
 {
-  auto p = new UnaryOperatorExpression(unary_operator, subexpression);
-  return std::shared_ptr<UnaryOperatorExpression>(p);
+  return arena.own(new (arena.allocate<UnaryOperatorExpression>()) UnaryOperatorExpression(unary_operator,
+											    subexpression));
 }
 
-ValueSP UnaryOperatorExpression::evaluate(ExpressionEvaluationContext& evaluation_context) const
+bool UnaryOperatorExpression::classof(const ASTNode* node)
 {
-  ValueSP subexpression_value_sp = m_subexpression->evaluate(evaluation_context);
+  return node->get_kind() == Kind::UNARY_OPERATOR_EXPRESSION;
+}
+
+void UnaryOperatorExpression::compile(ExpressionProgram& program) const
+{
+  m_subexpression->compile(program);
   switch (m_unary_operator->get())
   {
   case UnaryOperatorEnum::LOW_BYTE:
-    return low_byte(subexpression_value_sp);
+    program.emit(ExpressionProgram::Opcode::LOW_BYTE);
+    break;
   case UnaryOperatorEnum::HIGH_BYTE:
-    return high_byte(subexpression_value_sp);
+    program.emit(ExpressionProgram::Opcode::HIGH_BYTE);
+    break;
   default:
     throw std::logic_error(std::format("internal error: UnaryOperatorEnum value invalid"));
   }
 }
 
+void UnaryOperatorExpression::remap_symbols(std::span<const SymbolId> symbols)
+{
+  m_subexpression->remap_symbols(symbols);
+}
+
 std::string UnaryOperatorExpression::debug_dump()
 {
   return std::format("({}{})",
@@ -199,17 +340,22 @@ std::string UnaryOperatorExpression::debug_dump()
 		     m_subexpression->debug_dump());
 }
 
-UnaryOperatorExpression::UnaryOperatorExpression(std::shared_ptr<UnaryOperator> unary_operator,
-						 std::shared_ptr<Expression> subexpression):
+UnaryOperatorExpression::UnaryOperatorExpression(UnaryOperator* unary_operator,
+						 Expression* subexpression):
+  Expression(Kind::UNARY_OPERATOR_EXPRESSION),
   m_unary_operator(unary_operator),
   m_subexpression(subexpression)
 {
 }
 
-std::shared_ptr<BinaryOperator> BinaryOperator::create(BinaryOperatorEnum binary_operator)
+BinaryOperator* BinaryOperator::create(ASTArena& arena, BinaryOperatorEnum binary_operator)
+{
+  return arena.own(new (arena.allocate<BinaryOperator>()) BinaryOperator(binary_operator));
+}
+
+bool BinaryOperator::classof(const ASTNode* node)
 {
-  auto p = new BinaryOperator(binary_operator);
-  return std::shared_ptr<BinaryOperator>(p);
+  return node->get_kind() == Kind::BINARY_OPERATOR;
 }
 
 BinaryOperatorEnum BinaryOperator::get() const
@@ -241,38 +387,56 @@ std::string BinaryOperator::debug_dump()
 }
 
 BinaryOperator::BinaryOperator(BinaryOperatorEnum binary_operator):
+  ASTNode(Kind::BINARY_OPERATOR),
   m_binary_operator(binary_operator)
 {
 }
 
-std::shared_ptr<BinaryOperatorExpression> BinaryOperatorExpression::create(std::shared_ptr<Expression> left_subexpression,
-									   std::shared_ptr<BinaryOperator> binary_operator,
-									   std::shared_ptr<Expression> right_subexpression)
+BinaryOperatorExpression* BinaryOperatorExpression::create(ASTArena& arena,
+							   Expression* left_subexpression,
+							   BinaryOperator* binary_operator,
+							   Expression* right_subexpression)
 {
-  auto p = new BinaryOperatorExpression(left_subexpression, binary_operator, right_subexpression);
-  return std::shared_ptr<BinaryOperatorExpression>(p);
+  return arena.own(new (arena.allocate<BinaryOperatorExpression>()) BinaryOperatorExpression(left_subexpression,
+											      binary_operator,
+											      right_subexpression));
 }
 
-ValueSP BinaryOperatorExpression::evaluate(ExpressionEvaluationContext& evaluation_context) const
+bool BinaryOperatorExpression::classof(const ASTNode* node)
 {
-  ValueSP left_subexpression_value = m_left_subexpression->evaluate(evaluation_context);
-  ValueSP right_subexpression_value = m_right_subexpression->evaluate(evaluation_context);
+  return node->get_kind() == Kind::BINARY_OPERATOR_EXPRESSION;
+}
+
+void BinaryOperatorExpression::compile(ExpressionProgram& program) const
+{
+  m_left_subexpression->compile(program);
+  m_right_subexpression->compile(program);
 
   switch (m_binary_operator->get())
   {
   case BinaryOperatorEnum::ADDITION:
-    return left_subexpression_value + right_subexpression_value;
+    program.emit(ExpressionProgram::Opcode::ADD);
+    break;
   case BinaryOperatorEnum::SUBTRACTION:
-    return left_subexpression_value - right_subexpression_value;
+    program.emit(ExpressionProgram::Opcode::SUBTRACT);
+    break;
   case BinaryOperatorEnum::MULTIPLICATION:
-    return left_subexpression_value * right_subexpression_value;
+    program.emit(ExpressionProgram::Opcode::MULTIPLY);
+    break;
   case BinaryOperatorEnum::DIVISION:
-    return left_subexpression_value / right_subexpression_value;
+    program.emit(ExpressionProgram::Opcode::DIVIDE);
+    break;
   default:
     throw std::logic_error(std::format("internal error: BinaryOperatorEnum value invalid"));
   }
 }
 
+void BinaryOperatorExpression::remap_symbols(std::span<const SymbolId> symbols)
+{
+  m_left_subexpression->remap_symbols(symbols);
+  m_right_subexpression->remap_symbols(symbols);
+}
+
 std::string BinaryOperatorExpression::debug_dump()
 {
   return std::format("({}{}{})",
@@ -281,27 +445,32 @@ std::string BinaryOperatorExpression::debug_dump()
 		     m_right_subexpression->debug_dump());
 }
 
-BinaryOperatorExpression::BinaryOperatorExpression(std::shared_ptr<Expression> left_subexpression,
-						   std::shared_ptr<BinaryOperator> binary_operator,
-						   std::shared_ptr<Expression> right_subexpression):
+BinaryOperatorExpression::BinaryOperatorExpression(Expression* left_subexpression,
+						   BinaryOperator* binary_operator,
+						   Expression* right_subexpression):
+  Expression(Kind::BINARY_OPERATOR_EXPRESSION),
   m_left_subexpression(left_subexpression),
   m_binary_operator(binary_operator),
   m_right_subexpression(right_subexpression)
 {
 }
 
-std::shared_ptr<ExpressionList> ExpressionList::create()
+ExpressionList* ExpressionList::create(ASTArena& arena)
 {
-  auto p = new ExpressionList();
-  return std::shared_ptr<ExpressionList>(p);
+  return arena.own(new (arena.allocate<ExpressionList>()) ExpressionList(arena.get_memory_resource()));
 }
 
-void ExpressionList::append_expression(ExpressionSP expression_sp)
+bool ExpressionList::classof(const ASTNode* node)
 {
-  m_expressions.push_back(expression_sp);
+  return node->get_kind() == Kind::EXPRESSION_LIST;
 }
 
-const std::vector<std::shared_ptr<Expression>>& ExpressionList::get() const
+void ExpressionList::append_expression(Expression* expression)
+{
+  m_expressions.push_back(expression);
+}
+
+std::span<Expression* const> ExpressionList::get() const
 {
   return m_expressions;
 }
@@ -310,7 +479,7 @@ std::string ExpressionList::debug_dump()
 {
   std::string s = "ExpressionList(";
   bool first = true;
-  for (const auto& expression_sp: m_expressions)
+  for (const auto expression: m_expressions)
   {
     if (first)
     {
@@ -320,9 +489,9 @@ std::string ExpressionList::debug_dump()
     {
       s += ',';
     }
-    if (expression_sp)
+    if (expression)
     {
-      s += expression_sp->debug_dump();
+      s += expression->debug_dump();
     }
     else
     {
@@ -333,67 +502,146 @@ std::string ExpressionList::debug_dump()
   return s;
 }
 
-ExpressionList::ExpressionList()
+ExpressionList::ExpressionList(std::pmr::memory_resource* memory_resource):
+  ASTNode(Kind::EXPRESSION_LIST),
+  m_expressions(memory_resource)
+{
+}
+
+Statement* Statement::create(ASTArena& arena)
 {
+  return arena.own(new (arena.allocate<Statement>()) Statement(arena.get_memory_resource()));
 }
 
-std::shared_ptr<Statement> Statement::create()
+bool Statement::classof(const ASTNode* node)
 {
-  auto p = new Statement();
-  return std::shared_ptr<Statement>(p);
+  return node->get_kind() == Kind::STATEMENT;
 }
 
-void Statement::set_label(const std::string& label)
+void Statement::set_label(SymbolId label)
 {
   m_label = label;
 }
 
-void Statement::set_mnemonic(const std::string& mnemonic)
+void Statement::set_mnemonic(const Mnemonic* mnemonic)
 {
-  m_mnemonic = mnemonic;
+  m_mnemonic = mnemonic->get();
+  m_mnemonic_kind = mnemonic->get_mnemonic_kind();
+  m_instruction_infos = mnemonic->get_instruction_infos();
+  m_pseudo_op = mnemonic->get_pseudo_op();
 }
 
-void Statement::add_operand(ExpressionSP operand)
+void Statement::add_operand(Expression* operand)
 {
   m_operands.push_back(operand);
 }
 
-void Statement::set_operands(const std::vector<ExpressionSP>& operands)
+void Statement::set_operands(std::span<Expression* const> operands)
 {
-  m_operands = operands;
+  m_operands.assign(operands.begin(), operands.end());
 }
 
-const std::string& Statement::get_label() const
+bool Statement::has_label() const
+{
+  return m_label != SymbolTable::NO_SYMBOL;
+}
+
+SymbolId Statement::get_label() const
 {
   return m_label;
 }
 
-const std::string& Statement::get_mnemonic() const
+std::string_view Statement::get_mnemonic() const
 {
   return m_mnemonic;
 }
 
+MnemonicKind Statement::get_mnemonic_kind() const
+{
+  return m_mnemonic_kind;
+}
+
+std::span<const InstructionSet::Info> Statement::get_instruction_infos() const
+{
+  return m_instruction_infos;
+}
+
+PseudoOp::PseudoOpEnum Statement::get_pseudo_op() const
+{
+  return m_pseudo_op;
+}
+
 std::size_t Statement::get_operand_count() const
 {
   return m_operands.size();
 }
 
-const std::shared_ptr<Expression> Statement::get_operand(std::size_t index) const
+Expression* Statement::get_operand(std::size_t index) const
 {
   return m_operands.at(index);  // may throw std::out_of_range
 }
 
-const std::vector<std::shared_ptr<Expression>>& Statement::get_operands() const
+std::span<Expression* const> Statement::get_operands() const
 {
   return m_operands;
 }
 
+void Statement::compile()
+{
+  // the programs share the statement's arena, so compiling a line
+  // doesn't touch the general-purpose heap
+  std::pmr::memory_resource* memory_resource = m_operands.get_allocator().resource();
+  m_operand_programs.clear();
+  m_operand_programs.reserve(m_operands.size());
+  for (Expression* operand: m_operands)
+  {
+    ExpressionProgram& program = m_operand_programs.emplace_back(memory_resource);
+    if (StringConstant::classof(operand))
+    {
+      continue;
+    }
+    operand->compile(program);
+  }
+}
+
+const ExpressionProgram& Statement::get_operand_program(std::size_t index) const
+{
+  return m_operand_programs.at(index);  // may throw std::out_of_range
+}
+
+std::span<const ExpressionProgram> Statement::get_operand_programs() const
+{
+  return m_operand_programs;
+}
+
+void Statement::remap_symbols(std::span<const SymbolId> symbols)
+{
+  if (has_label())
+  {
+    m_label = symbols[m_label];
+  }
+  for (Expression* operand: m_operands)
+  {
+    operand->remap_symbols(symbols);
+  }
+  for (ExpressionProgram& program: m_operand_programs)
+  {
+    program.remap_symbols(symbols);
+  }
+}
+
 std::string Statement::debug_dump()
 {
   return std::format("Statement");
 }
 
-Statement::Statement()
+Statement::Statement(std::pmr::memory_resource* memory_resource):
+  ASTNode(Kind::STATEMENT),
+  m_label(SymbolTable::NO_SYMBOL),
+  m_mnemonic_kind(MnemonicKind::NONE),
+  m_pseudo_op(),
+  m_operands(memory_resource),
+  m_operand_programs(memory_resource)
 {
 }
 
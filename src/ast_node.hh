@@ -6,105 +6,209 @@
 #ifndef AST_NODE_HH
 #define AST_NODE_HH
 
-#include <memory>
+#include <format>
+#include <memory_resource>
 #include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include <magic_enum.hpp>
 #include <magic_enum_containers.hpp>
 
+#include "ast_arena.hh"
+#include "expression_program.hh"
+#include "instruction_set.hh"
+#include "pseudo_op.hh"
 #include "symbol_table.hh"
 #include "value.hh"
 
+// All AST nodes are allocated in an ASTArena, and are referred to by
+// non-owning pointers. Each node records its kind, so that node_cast
+// can downcast with a check but without RTTI. Mnemonics and string
+// constants are views into the parsed source text, which must outlive
+// the AST.
 class ASTNode
 {
 public:
+  enum class Kind
+  {
+    LABEL,
+    MNEMONIC,
+    UNARY_OPERATOR,
+    BINARY_OPERATOR,
+    EXPRESSION_LIST,
+    STATEMENT,
+
+    // expressions, must be contiguous
+    CONSTANT,
+    LOCATION_COUNTER,
+    STRING_CONSTANT,
+    SYMBOL,
+    UNARY_OPERATOR_EXPRESSION,
+    BINARY_OPERATOR_EXPRESSION,
+  };
+
+  Kind get_kind() const;
   virtual std::string debug_dump() = 0;
+
+protected:
+  ASTNode(Kind kind);
+  Kind m_kind;
 };
-using ASTNodeSP = std::shared_ptr<ASTNode>;
+using ASTNodePtr = ASTNode*;
+
+class ASTNodeCastError: public std::logic_error
+{
+public:
+  ASTNodeCastError(ASTNode::Kind kind);
+};
+
+// checked static downcast
+template <typename T>
+T* node_cast(ASTNode* node)
+{
+  if (! T::classof(node))
+  {
+    throw ASTNodeCastError(node->get_kind());
+  }
+  return static_cast<T*>(node);
+}
 
 class Label: public ASTNode
 {
 public:
-  static std::shared_ptr<Label> create(const std::string& mnemonic);
-  const std::string& get() const;
+  static Label* create(ASTArena& arena, SymbolId label);
+  static bool classof(const ASTNode* node);
+  SymbolId get() const;
   std::string debug_dump() override;
 
 protected:
-  Label(const std::string& mnemonic);
-  std::string m_label;
+  Label(SymbolId label);
+  SymbolId m_label;
+};
+using LabelPtr = Label*;
+
+// A mnemonic is resolved to its instruction set entries or pseudo-op
+// when it is parsed, so that the assembler never has to look it up by
+// name.
+enum class MnemonicKind
+{
+  NONE,          // statement has no mnemonic
+  UNRECOGNIZED,
+  INSTRUCTION,
+  PSEUDO_OP,
 };
-using LabelSP = std::shared_ptr<Label>;
 
 class Mnemonic: public ASTNode
 {
 public:
-  static std::shared_ptr<Mnemonic> create(const std::string& mnemonic);
-  const std::string& get() const;
+  // instruction_infos is empty if the mnemonic is unrecognized
+  static Mnemonic* create(ASTArena& arena,
+			  std::string_view mnemonic,
+			  std::span<const InstructionSet::Info> instruction_infos);
+  static Mnemonic* create(ASTArena& arena,
+			  std::string_view mnemonic,
+			  PseudoOp::PseudoOpEnum pseudo_op);
+  static bool classof(const ASTNode* node);
+  std::string_view get() const;
+  MnemonicKind get_mnemonic_kind() const;
+  std::span<const InstructionSet::Info> get_instruction_infos() const;
+  PseudoOp::PseudoOpEnum get_pseudo_op() const;
   std::string debug_dump() override;
 
 protected:
-  Mnemonic(const std::string& mnemonic);
-  std::string m_mnemonic;
-};
-using MnemonicSP = std::shared_ptr<Mnemonic>;
-
-struct ExpressionEvaluationContext
-{
-  std::shared_ptr<SymbolTable> symbol_table_sp;
-  unsigned source_line_number;
+  Mnemonic(std::string_view mnemonic,
+	   std::span<const InstructionSet::Info> instruction_infos);
+  Mnemonic(std::string_view mnemonic,
+	   PseudoOp::PseudoOpEnum pseudo_op);
+  std::string_view m_mnemonic;
+  MnemonicKind m_mnemonic_kind;
+  std::span<const InstructionSet::Info> m_instruction_infos;
+  PseudoOp::PseudoOpEnum m_pseudo_op;
 };
+using MnemonicPtr = Mnemonic*;
 
 class Expression: public ASTNode
 {
 public:
-  virtual ValueSP evaluate(ExpressionEvaluationContext& evaluation_context) const = 0;
+  static bool classof(const ASTNode* node);
+
+  // append the postfix code for this expression to program
+  virtual void compile(ExpressionProgram& program) const = 0;
+
+  // replace each SymbolId s in the expression with symbols[s], for an
+  // expression parsed against another symbol table
+  virtual void remap_symbols(std::span<const SymbolId> symbols);
+
+protected:
+  Expression(Kind kind);
 };
-using ExpressionSP = std::shared_ptr<Expression>;
+using ExpressionPtr = Expression*;
 
 class Constant: public Expression
 {
 public:
-  static std::shared_ptr<Constant> create(std::uint16_t value);
-  static std::shared_ptr<Constant> create(ValueSP value_sp);
-  ValueSP get() const;
-  ValueSP evaluate(ExpressionEvaluationContext& evaluation_context) const override;
+  static Constant* create(ASTArena& arena, std::uint16_t value);
+  static Constant* create(ASTArena& arena, Value value);
+  static bool classof(const ASTNode* node);
+  Value get() const;
+  void compile(ExpressionProgram& program) const override;
   std::string debug_dump() override;
 
 protected:
   Constant(std::uint16_t value);
-  Constant(ValueSP value_sp);
-  ValueSP m_value_sp;
+  Constant(Value value);
+  Value m_value;
 };
-using ConstantSP = std::shared_ptr<Constant>;
+using ConstantPtr = Constant*;
+
+// The location counter is resolved when the expression is evaluated,
+// not when it is parsed, so a statement can be reused across passes.
+class LocationCounter: public Expression
+{
+public:
+  static LocationCounter* create(ASTArena& arena);
+  static bool classof(const ASTNode* node);
+  void compile(ExpressionProgram& program) const override;
+  std::string debug_dump() override;
+
+protected:
+  LocationCounter();
+};
+using LocationCounterPtr = LocationCounter*;
 
 class StringConstant: public Expression
 {
 public:
-  static std::shared_ptr<StringConstant> create(const std::string& string);
-  const std::string& get() const;
-  ValueSP evaluate(ExpressionEvaluationContext& evaluation_context) const override;
+  static StringConstant* create(ASTArena& arena, std::string_view string);
+  static bool classof(const ASTNode* node);
+  std::string_view get() const;
+  void compile(ExpressionProgram& program) const override;
   std::string debug_dump() override;
 
 protected:
-  StringConstant(const std::string& string);
-  std::string m_string;
+  StringConstant(std::string_view string);
+  std::string_view m_string;
 };
-using StringConstantSP = std::shared_ptr<StringConstant>;
+using StringConstantPtr = StringConstant*;
 
 class Symbol: public Expression
 {
 public:
-  static std::shared_ptr<Symbol> create(const std::string& symbol);
-  const std::string& get() const;
-  ValueSP evaluate(ExpressionEvaluationContext& evaluation_context) const override;
+  static Symbol* create(ASTArena& arena, SymbolId symbol);
+  static bool classof(const ASTNode* node);
+  SymbolId get() const;
+  void compile(ExpressionProgram& program) const override;
+  void remap_symbols(std::span<const SymbolId> symbols) override;
   std::string debug_dump() override;
 
 protected:
-  Symbol(const std::string& symbol);
-  std::string m_symbol;
+  Symbol(SymbolId symbol);
+  SymbolId m_symbol;
 };
-using SymbolSP = std::shared_ptr<Symbol>;
+using SymbolPtr = Symbol*;
 
 enum class UnaryOperatorEnum
 {
@@ -115,7 +219,8 @@ enum class UnaryOperatorEnum
 class UnaryOperator: public ASTNode
 {
 public:
-  static std::shared_ptr<UnaryOperator> create(UnaryOperatorEnum unary_operator);
+  static UnaryOperator* create(ASTArena& arena, UnaryOperatorEnum unary_operator);
+  static bool classof(const ASTNode* node);
   UnaryOperatorEnum get() const;
   std::string debug_dump() override;
 
@@ -123,21 +228,24 @@ protected:
   UnaryOperator(UnaryOperatorEnum unary_operator);
   UnaryOperatorEnum m_unary_operator;
 };
-using UnaryOperatorSP = std::shared_ptr<UnaryOperator>;
+using UnaryOperatorPtr = UnaryOperator*;
 
 class UnaryOperatorExpression: public Expression
 {
 public:
-  static std::shared_ptr<UnaryOperatorExpression> create(std::shared_ptr<UnaryOperator> unary_operator,
-							 std::shared_ptr<Expression> subexpression);
-  ValueSP evaluate(ExpressionEvaluationContext& evaluation_context) const;
+  static UnaryOperatorExpression* create(ASTArena& arena,
+					 UnaryOperator* unary_operator,
+					 Expression* subexpression);
+  static bool classof(const ASTNode* node);
+  void compile(ExpressionProgram& program) const override;
+  void remap_symbols(std::span<const SymbolId> symbols) override;
   std::string debug_dump() override;
 
 protected:
-  UnaryOperatorExpression(std::shared_ptr<UnaryOperator> unary_operator,
-			  std::shared_ptr<Expression> subexpression);
-  std::shared_ptr<UnaryOperator> m_unary_operator;
-  std::shared_ptr<Expression> m_subexpression;
+  UnaryOperatorExpression(UnaryOperator* unary_operator,
+			  Expression* subexpression);
+  UnaryOperator* m_unary_operator;
+  Expression* m_subexpression;
 };
 
 enum class BinaryOperatorEnum
@@ -151,7 +259,8 @@ enum class BinaryOperatorEnum
 class BinaryOperator: public ASTNode
 {
 public:
-  static std::shared_ptr<BinaryOperator> create(BinaryOperatorEnum binary_operator);
+  static BinaryOperator* create(ASTArena& arena, BinaryOperatorEnum binary_operator);
+  static bool classof(const ASTNode* node);
   BinaryOperatorEnum get() const;
   std::string debug_dump() override;
 
@@ -159,64 +268,87 @@ protected:
   BinaryOperator(BinaryOperatorEnum binary_operator);
   BinaryOperatorEnum m_binary_operator;
 };
-using BinaryOperatorSP = std::shared_ptr<BinaryOperator>;
+using BinaryOperatorPtr = BinaryOperator*;
 
 class BinaryOperatorExpression: public Expression
 {
 public:
-  static std::shared_ptr<BinaryOperatorExpression> create(std::shared_ptr<Expression> left_subexpression,
-							  std::shared_ptr<BinaryOperator> binary_operator,
-							  std::shared_ptr<Expression> right_subexpression);
-  ValueSP evaluate(ExpressionEvaluationContext& evaluation_context) const;
+  static BinaryOperatorExpression* create(ASTArena& arena,
+					  Expression* left_subexpression,
+					  BinaryOperator* binary_operator,
+					  Expression* right_subexpression);
+  static bool classof(const ASTNode* node);
+  void compile(ExpressionProgram& program) const override;
+  void remap_symbols(std::span<const SymbolId> symbols) override;
   std::string debug_dump() override;
 
 protected:
-  BinaryOperatorExpression(std::shared_ptr<Expression> left_subexpression,
-			   std::shared_ptr<BinaryOperator> binary_operator,
-			   std::shared_ptr<Expression> right_subexpression);
-  std::shared_ptr<Expression> m_left_subexpression;
-  std::shared_ptr<BinaryOperator> m_binary_operator;
-  std::shared_ptr<Expression> m_right_subexpression;
+  BinaryOperatorExpression(Expression* left_subexpression,
+			   BinaryOperator* binary_operator,
+			   Expression* right_subexpression);
+  Expression* m_left_subexpression;
+  BinaryOperator* m_binary_operator;
+  Expression* m_right_subexpression;
 };
 
 class ExpressionList: public ASTNode
 {
 public:
-  static std::shared_ptr<ExpressionList> create();
-  void append_expression(std::shared_ptr<Expression> expression_sp);
-  const std::vector<std::shared_ptr<Expression>>& get() const;
+  static ExpressionList* create(ASTArena& arena);
+  static bool classof(const ASTNode* node);
+  void append_expression(Expression* expression);
+  std::span<Expression* const> get() const;
   std::string debug_dump() override;
 
 protected:
-  ExpressionList();
-  std::vector<std::shared_ptr<Expression>> m_expressions;
+  ExpressionList(std::pmr::memory_resource* memory_resource);
+  std::pmr::vector<Expression*> m_expressions;
 };
-using ExpressionListSP = std::shared_ptr<ExpressionList>;
+using ExpressionListPtr = ExpressionList*;
 
 class Statement: public ASTNode
 {
 public:
-  static std::shared_ptr<Statement> create();
+  static Statement* create(ASTArena& arena);
+  static bool classof(const ASTNode* node);
+
+  void set_label(SymbolId label);
+  void set_mnemonic(const Mnemonic* mnemonic);
+  void add_operand(Expression* operand);
+  void set_operands(std::span<Expression* const> operands);
+
+  bool has_label() const;
+  SymbolId get_label() const;
+  std::string_view get_mnemonic() const;
+  MnemonicKind get_mnemonic_kind() const;
+  std::span<const InstructionSet::Info> get_instruction_infos() const;  // only for INSTRUCTION
+  PseudoOp::PseudoOpEnum get_pseudo_op() const;                         // only for PSEUDO_OP
+  std::size_t get_operand_count() const;
+  Expression* get_operand(std::size_t index) const;  // zero-indexed
+  std::span<Expression* const> get_operands() const;
 
-  void set_label(const std::string& label);
-  void set_mnemonic(const std::string& mnemonic);
-  void add_operand(ExpressionSP operand);
-  void set_operands(const std::vector<ExpressionSP>& operands);
+  // lower each numeric operand to an ExpressionProgram; string
+  // operands get an empty program
+  void compile();
+  const ExpressionProgram& get_operand_program(std::size_t index) const;  // zero-indexed
+  std::span<const ExpressionProgram> get_operand_programs() const;
 
-  const std::string& get_label() const;
-  const std::string& get_mnemonic() const;
-  std::size_t get_operand_count() const;
-  const std::shared_ptr<Expression> get_operand(std::size_t index) const;  // zero-indexed
-  const std::vector<std::shared_ptr<Expression>>& get_operands() const;
+  // replace each SymbolId s in the label, operands and programs with
+  // symbols[s], for a statement parsed against another symbol table
+  void remap_symbols(std::span<const SymbolId> symbols);
 
   std::string debug_dump() override;
 
 protected:
-  Statement();
-  std::string m_label;
-  std::string m_mnemonic;
-  std::vector<std::shared_ptr<Expression>> m_operands;
+  Statement(std::pmr::memory_resource* memory_resource);
+  SymbolId m_label;
+  std::string_view m_mnemonic;
+  MnemonicKind m_mnemonic_kind;
+  std::span<const InstructionSet::Info> m_instruction_infos;
+  PseudoOp::PseudoOpEnum m_pseudo_op;
+  std::pmr::vector<Expression*> m_operands;
+  std::pmr::vector<ExpressionProgram> m_operand_programs;
 };
-using StatementSP = std::shared_ptr<Statement>;
+using StatementPtr = Statement*;
 
 #endif // AST_NODE_HH
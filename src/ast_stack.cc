@@ -3,7 +3,6 @@
 // Copyright 2025 Eric Smith
 // SPDX-License-Identifier: GPL-3.0-only
 
-#include "ast_node.hh"
 #include "ast_stack.hh"
 
 ASTStackUnderflow::ASTStackUnderflow():
@@ -21,6 +20,11 @@ ASTStack::ASTStack()
 {
 }
 
+void ASTStack::reserve(std::size_t capacity)
+{
+  m_stack.reserve(capacity);
+}
+
 bool ASTStack::empty() const
 {
   return m_stack.empty();
@@ -36,20 +40,28 @@ void ASTStack::clear()
   m_stack.clear();
 }
 
-void ASTStack::push(ASTNodeSP node)
+void ASTStack::push(ASTNode* node)
 {
   m_stack.push_back(node);
 }
 
-ASTNodeSP ASTStack::pop()
+ASTNode* ASTStack::pop()
 {
-  ASTNodeSP node = m_stack.back();
+  if (m_stack.empty())
+  {
+    throw ASTStackUnderflow();
+  }
+  ASTNode* node = m_stack.back();
   m_stack.pop_back();
   return node;
 }
 
-ASTNodeSP ASTStack::peek_top() const
+ASTNode* ASTStack::peek_top() const
 {
+  if (m_stack.empty())
+  {
+    throw ASTStackUnderflow();
+  }
   return m_stack.back();
 }
 
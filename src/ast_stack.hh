@@ -11,8 +11,7 @@
 #include <stdexcept>
 #include <vector>
 
-class ASTNode;
-using ASTNodeSP = std::shared_ptr<ASTNode>;
+#include "ast_node.hh"
 
 class ASTStackUnderflow: public std::runtime_error
 {
@@ -25,31 +24,34 @@ class ASTStack
 public:
   static std::shared_ptr<ASTStack> create();
 
+  // preallocate space so that pushes don't reallocate
+  void reserve(std::size_t capacity);
+
   bool empty() const;
   std::size_t size() const;
 
   void clear();
-  void push(ASTNodeSP node);
-  ASTNodeSP pop();
-  ASTNodeSP peek_top() const;
+  void push(ASTNode* node);
+  ASTNode* pop();
+  ASTNode* peek_top() const;
 
   template <typename T>
-  std::shared_ptr<T> pop()
+  T* pop()
   {
-    return std::dynamic_pointer_cast<T>(pop());
+    return node_cast<T>(pop());
   }
 
   template <typename T>
-  std::shared_ptr<T> peek_top() const
+  T* peek_top() const
   {
-    return std::dynamic_pointer_cast<T>(peek_top());
+    return node_cast<T>(peek_top());
   }
 
   void debug_dump(std::ostream& os);
 
 protected:
   ASTStack();
-  std::vector<ASTNodeSP> m_stack;
+  std::vector<ASTNode*> m_stack;
 };
 using ASTStackSP = std::shared_ptr<ASTStack>;
 
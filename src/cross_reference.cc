@@ -0,0 +1,63 @@
+// cross_reference.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <algorithm>
+
+#include "cross_reference.hh"
+
+std::shared_ptr<CrossReference> CrossReference::create()
+{
+  auto p = new CrossReference();
+  return std::shared_ptr<CrossReference>(p);
+}
+
+CrossReference::CrossReference()
+{
+}
+
+void CrossReference::clear()
+{
+  m_log.clear();
+  m_line_numbers.clear();
+  m_symbol_starts.clear();
+}
+
+void CrossReference::add(SymbolId symbol,
+			 unsigned source_line_number)
+{
+  m_log.push_back((std::uint64_t(symbol) << 32) | std::uint32_t(source_line_number));
+}
+
+void CrossReference::sort(std::size_t symbol_count)
+{
+  std::sort(m_log.begin(), m_log.end());
+  m_log.erase(std::unique(m_log.begin(), m_log.end()), m_log.end());
+
+  m_line_numbers.resize(m_log.size());
+  m_symbol_starts.assign(symbol_count + 1, 0);
+  for (std::size_t i = 0; i < m_log.size(); i++)
+  {
+    m_line_numbers[i] = std::uint32_t(m_log[i]);
+    ++m_symbol_starts[(m_log[i] >> 32) + 1];
+  }
+  for (std::size_t symbol = 0; symbol < symbol_count; symbol++)
+  {
+    m_symbol_starts[symbol + 1] += m_symbol_starts[symbol];
+  }
+
+  // the log isn't needed again until the next collection, but its
+  // capacity is kept for it
+  m_log.clear();
+}
+
+std::span<const std::uint32_t> CrossReference::get_reference_line_numbers(SymbolId symbol) const
+{
+  if (symbol + std::size_t(1) >= m_symbol_starts.size())
+  {
+    return {};
+  }
+  return std::span<const std::uint32_t>(m_line_numbers).subspan(m_symbol_starts[symbol],
+								m_symbol_starts[symbol + 1] - m_symbol_starts[symbol]);
+}
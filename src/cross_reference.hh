@@ -0,0 +1,54 @@
+// cross_reference.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef CROSS_REFERENCE_HH
+#define CROSS_REFERENCE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "symbol_id.hh"
+
+// The source lines that refer to each symbol. References are appended
+// to a flat log of (symbol, line) pairs, in any order and possibly
+// repeated, which is sorted once when collection is complete. Only
+// then can the references of a symbol be retrieved.
+class CrossReference
+{
+public:
+  static std::shared_ptr<CrossReference> create();
+
+  CrossReference           (const CrossReference& ) = delete;  // no copy constructor
+  CrossReference           (      CrossReference& ) = delete;  // no move constructor
+  CrossReference& operator=(const CrossReference& ) = delete;  // no copy assignment
+  CrossReference& operator=(      CrossReference&&) = delete;  // no move assignment
+
+  void clear();
+
+  void add(SymbolId symbol,
+	   unsigned source_line_number);
+
+  // Sorts the log by symbol and line, drops repeated references, and
+  // indexes it by symbol; symbol_count must exceed every symbol ID.
+  void sort(std::size_t symbol_count);
+
+  // ascending line numbers of the references to a symbol, once sorted
+  std::span<const std::uint32_t> get_reference_line_numbers(SymbolId symbol) const;
+
+protected:
+  CrossReference();
+
+  // Each reference is packed as the symbol in the upper half and the
+  // line number in the lower, so that sorting orders by both.
+  std::vector<std::uint64_t> m_log;
+
+  std::vector<std::uint32_t> m_line_numbers;  // of all references, grouped by symbol
+  std::vector<std::uint32_t> m_symbol_starts; // index into m_line_numbers, by symbol
+};
+
+#endif // CROSS_REFERENCE_HH
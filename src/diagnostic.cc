@@ -0,0 +1,122 @@
+// diagnostic.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <algorithm>
+#include <format>
+
+#include "diagnostic.hh"
+
+static const magic_enum::containers::array<Severity, const char*> s_severity_names
+{
+  "note",
+  "warning",
+  "error",
+  "fatal error",
+};
+
+void append_diagnostic(std::string& s, const Diagnostic& diagnostic)
+{
+  s += diagnostic.file;
+  if (diagnostic.line)
+  {
+    s += std::format(":{}", diagnostic.line);
+    if (diagnostic.column)
+    {
+      s += std::format(":{}", diagnostic.column);
+    }
+  }
+  s += std::format(": {}: {}\n", s_severity_names[diagnostic.severity], diagnostic.message);
+}
+
+DiagnosticSink::~DiagnosticSink()
+{
+}
+
+std::shared_ptr<BufferedDiagnosticSink> BufferedDiagnosticSink::create()
+{
+  auto p = new BufferedDiagnosticSink();
+  return std::shared_ptr<BufferedDiagnosticSink>(p);
+}
+
+BufferedDiagnosticSink::BufferedDiagnosticSink()
+{
+}
+
+void BufferedDiagnosticSink::report(const Diagnostic& diagnostic)
+{
+  m_diagnostics.push_back(diagnostic);
+  ++m_counts[diagnostic.severity];
+}
+
+std::span<const Diagnostic> BufferedDiagnosticSink::get() const
+{
+  return m_diagnostics;
+}
+
+unsigned BufferedDiagnosticSink::get_count(Severity severity) const
+{
+  return m_counts[severity];
+}
+
+void BufferedDiagnosticSink::sort_by_line()
+{
+  std::ranges::stable_sort(m_diagnostics, {}, & Diagnostic::line);
+}
+
+void BufferedDiagnosticSink::append_to(std::string& s) const
+{
+  for (const auto& diagnostic: m_diagnostics)
+  {
+    append_diagnostic(s, diagnostic);
+  }
+}
+
+void BufferedDiagnosticSink::write(std::ostream& os) const
+{
+  std::string s;
+  append_to(s);
+  os.write(s.data(), s.size());
+  os.flush();
+}
+
+std::shared_ptr<DiagnosticCollector> DiagnosticCollector::create(std::size_t source_count)
+{
+  auto p = new DiagnosticCollector(source_count);
+  return std::shared_ptr<DiagnosticCollector>(p);
+}
+
+DiagnosticCollector::DiagnosticCollector(std::size_t source_count)
+{
+  for (std::size_t i = 0; i < source_count; i++)
+  {
+    m_sinks.push_back(BufferedDiagnosticSink::create());
+  }
+}
+
+std::shared_ptr<BufferedDiagnosticSink> DiagnosticCollector::get_sink(std::size_t source_index) const
+{
+  return m_sinks.at(source_index);
+}
+
+unsigned DiagnosticCollector::get_count(Severity severity) const
+{
+  unsigned count = 0;
+  for (const auto& sink: m_sinks)
+  {
+    count += sink->get_count(severity);
+  }
+  return count;
+}
+
+void DiagnosticCollector::flush(std::ostream& os) const
+{
+  std::string s;
+  for (const auto& sink: m_sinks)
+  {
+    sink->append_to(s);
+  }
+  os.write(s.data(), s.size());
+  os.flush();
+}
@@ -0,0 +1,105 @@
+// diagnostic.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef DIAGNOSTIC_HH
+#define DIAGNOSTIC_HH
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <magic_enum.hpp>
+#include <magic_enum_containers.hpp>
+
+enum class Severity
+{
+  NOTE,
+  WARNING,
+  ERROR,
+  FATAL,  // assembly of the file stopped
+};
+
+struct Diagnostic
+{
+  Severity severity;
+  std::string file;
+  unsigned line;    // zero if not associated with a line
+  unsigned column;  // zero if unknown
+  std::string message;
+};
+
+// "file:line:column: severity: message", omitting an unknown line or
+// column, followed by a newline
+void append_diagnostic(std::string& s, const Diagnostic& diagnostic);
+
+class DiagnosticSink
+{
+public:
+  virtual ~DiagnosticSink();
+  virtual void report(const Diagnostic& diagnostic) = 0;
+};
+
+// Holds diagnostics in the order they were reported, until the owner
+// writes them out. Not thread safe; each assembler, or each worker of
+// an assembler, has its own.
+class BufferedDiagnosticSink: public DiagnosticSink
+{
+public:
+  static std::shared_ptr<BufferedDiagnosticSink> create();
+
+  BufferedDiagnosticSink           (const BufferedDiagnosticSink& ) = delete;  // no copy constructor
+  BufferedDiagnosticSink           (      BufferedDiagnosticSink& ) = delete;  // no move constructor
+  BufferedDiagnosticSink& operator=(const BufferedDiagnosticSink& ) = delete;  // no copy assignment
+  BufferedDiagnosticSink& operator=(      BufferedDiagnosticSink&&) = delete;  // no move assignment
+
+  void report(const Diagnostic& diagnostic) override;
+
+  std::span<const Diagnostic> get() const;
+  unsigned get_count(Severity severity) const;
+
+  // stable, so that diagnostics for the same line keep their order
+  void sort_by_line();
+
+  void append_to(std::string& s) const;
+  void write(std::ostream& os) const;  // in a single write
+
+protected:
+  BufferedDiagnosticSink();
+
+  std::vector<Diagnostic> m_diagnostics;
+  magic_enum::containers::array<Severity, unsigned> m_counts {};
+};
+
+// Collects the diagnostics of a batch of source files assembled
+// concurrently. Each source file has its own sink, created up front,
+// which only the thread assembling that file writes to, so reporting
+// needs no locking. Once the batch has finished, flush() writes all of
+// the diagnostics in source file order.
+class DiagnosticCollector
+{
+public:
+  static std::shared_ptr<DiagnosticCollector> create(std::size_t source_count);
+
+  DiagnosticCollector           (const DiagnosticCollector& ) = delete;  // no copy constructor
+  DiagnosticCollector           (      DiagnosticCollector& ) = delete;  // no move constructor
+  DiagnosticCollector& operator=(const DiagnosticCollector& ) = delete;  // no copy assignment
+  DiagnosticCollector& operator=(      DiagnosticCollector&&) = delete;  // no move assignment
+
+  std::shared_ptr<BufferedDiagnosticSink> get_sink(std::size_t source_index) const;
+
+  unsigned get_count(Severity severity) const;
+
+  void flush(std::ostream& os) const;  // in a single write
+
+protected:
+  DiagnosticCollector(std::size_t source_count);
+
+  std::vector<std::shared_ptr<BufferedDiagnosticSink>> m_sinks;  // indexed by source
+};
+
+#endif // DIAGNOSTIC_HH
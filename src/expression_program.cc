@@ -0,0 +1,171 @@
+// expression_program.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <cstddef>
+#include <format>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+#include <magic_enum.hpp>
+
+#include "expression_program.hh"
+#include "symbol_table.hh"
+
+ExpressionProgram::ExpressionProgram(std::pmr::memory_resource* memory_resource):
+  m_code(memory_resource),
+  m_depth(0),
+  m_max_depth(0)
+{
+}
+
+bool ExpressionProgram::empty() const
+{
+  return m_code.empty();
+}
+
+std::span<const ExpressionProgram::Instruction> ExpressionProgram::get_code() const
+{
+  return m_code;
+}
+
+void ExpressionProgram::emit(Opcode opcode, std::uint32_t operand)
+{
+  switch (opcode)
+  {
+  case Opcode::PUSH_CONSTANT:
+  case Opcode::PUSH_SYMBOL:
+  case Opcode::PUSH_LOCATION_COUNTER:
+    ++m_depth;
+    if (m_depth > m_max_depth)
+    {
+      m_max_depth = m_depth;
+    }
+    break;
+  case Opcode::ADD:
+  case Opcode::SUBTRACT:
+  case Opcode::MULTIPLY:
+  case Opcode::DIVIDE:
+    if (m_depth < 2)
+    {
+      throw std::logic_error("internal error: expression program stack underflow");
+    }
+    --m_depth;
+    break;
+  case Opcode::LOW_BYTE:
+  case Opcode::HIGH_BYTE:
+    if (m_depth < 1)
+    {
+      throw std::logic_error("internal error: expression program stack underflow");
+    }
+    break;
+  }
+  m_code.push_back(Instruction { opcode, operand });
+}
+
+void ExpressionProgram::remap_symbols(std::span<const SymbolId> symbols)
+{
+  for (Instruction& instruction: m_code)
+  {
+    if (instruction.opcode == Opcode::PUSH_SYMBOL)
+    {
+      instruction.operand = symbols[instruction.operand];
+    }
+  }
+}
+
+// The values on the stack are never destroyed.
+static_assert(std::is_trivially_destructible_v<Value>);
+
+ValueExpected<Value> ExpressionProgram::evaluate(ExpressionEvaluationContext& evaluation_context) const
+{
+  if (m_depth != 1)
+  {
+    throw std::logic_error("internal error: can't evaluate incomplete or non-numeric expression");
+  }
+  if (m_max_depth <= INLINE_STACK_DEPTH)
+  {
+    // Uninitialized, so that evaluating a short program doesn't
+    // construct the whole stack; run() constructs each slot it pushes.
+    alignas(Value) std::byte stack[INLINE_STACK_DEPTH * sizeof(Value)];
+    return run(evaluation_context, reinterpret_cast<Value*>(stack));
+  }
+  std::vector<Value> stack(m_max_depth);
+  return run(evaluation_context, stack.data());
+}
+
+ValueExpected<Value> ExpressionProgram::run(ExpressionEvaluationContext& evaluation_context,
+					    Value* stack) const
+{
+  Value* sp = stack;  // points one past the top of stack
+  for (const Instruction& instruction: m_code)
+  {
+    switch (instruction.opcode)
+    {
+    case Opcode::PUSH_CONSTANT:
+      new (sp++) Value(static_cast<std::uint16_t>(instruction.operand));
+      break;
+    case Opcode::PUSH_SYMBOL:
+      new (sp++) Value(evaluation_context.symbol_table.lookup_symbol(evaluation_context.source_line_number,
+								     instruction.operand));
+      break;
+    case Opcode::PUSH_LOCATION_COUNTER:
+      new (sp++) Value(evaluation_context.location_counter);
+      break;
+    case Opcode::ADD:
+      --sp;
+      sp[-1] = sp[-1] + sp[0];
+      break;
+    case Opcode::SUBTRACT:
+      --sp;
+      sp[-1] = sp[-1] - sp[0];
+      break;
+    case Opcode::MULTIPLY:
+      --sp;
+      sp[-1] = sp[-1] * sp[0];
+      break;
+    case Opcode::DIVIDE:
+      --sp;
+      if (sp[0].known() && (sp[0].get() == 0))
+      {
+	return std::unexpected(ValueErrorKind::DIVIDE_BY_ZERO);
+      }
+      sp[-1] = sp[-1] / sp[0];
+      break;
+    case Opcode::LOW_BYTE:
+      sp[-1] = low_byte(sp[-1]);
+      break;
+    case Opcode::HIGH_BYTE:
+      sp[-1] = high_byte(sp[-1]);
+      break;
+    }
+  }
+  return stack[0];
+}
+
+std::string ExpressionProgram::debug_dump() const
+{
+  std::string s;
+  for (const Instruction& instruction: m_code)
+  {
+    if (s.size())
+    {
+      s += ' ';
+    }
+    s += magic_enum::enum_name(instruction.opcode);
+    switch (instruction.opcode)
+    {
+    case Opcode::PUSH_CONSTANT:
+      s += std::format("({})", instruction.operand);
+      break;
+    case Opcode::PUSH_SYMBOL:
+      s += std::format("(#{})", instruction.operand);
+      break;
+    default:
+      break;
+    }
+  }
+  return s;
+}
@@ -0,0 +1,87 @@
+// expression_program.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef EXPRESSION_PROGRAM_HH
+#define EXPRESSION_PROGRAM_HH
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "symbol_id.hh"
+#include "value.hh"
+
+class SymbolTable;
+
+// Lives only for the duration of an evaluation, so it refers to the
+// symbol table rather than sharing ownership of it.
+struct ExpressionEvaluationContext
+{
+  const SymbolTable& symbol_table;
+  unsigned source_line_number;
+  std::uint16_t location_counter;
+};
+
+// An expression lowered to a flat postfix program, evaluated by a
+// small stack interpreter. Expressions are compiled once after
+// parsing, so evaluation in each pass is a single loop over a
+// contiguous array, with no tree walk or virtual calls.
+class ExpressionProgram
+{
+public:
+  enum class Opcode: std::uint8_t
+  {
+    PUSH_CONSTANT,          // operand is the value
+    PUSH_SYMBOL,            // operand is the SymbolId
+    PUSH_LOCATION_COUNTER,
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    LOW_BYTE,
+    HIGH_BYTE,
+  };
+
+  struct Instruction
+  {
+    Opcode opcode;
+    std::uint32_t operand;
+  };
+
+  ExpressionProgram(std::pmr::memory_resource* memory_resource = std::pmr::get_default_resource());
+
+  bool empty() const;
+  std::span<const Instruction> get_code() const;
+
+  // append an instruction, tracking the stack depth it requires
+  void emit(Opcode opcode, std::uint32_t operand = 0);
+
+  // replace the operand s of each PUSH_SYMBOL with symbols[s]
+  void remap_symbols(std::span<const SymbolId> symbols);
+
+  // An unknown result (forward reference) is returned as an unknown
+  // Value; only an error that makes the expression meaningless, such
+  // as division by zero, is returned as an error.
+  ValueExpected<Value> evaluate(ExpressionEvaluationContext& evaluation_context) const;
+
+  std::string debug_dump() const;
+
+protected:
+  static constexpr std::size_t INLINE_STACK_DEPTH = 8;
+
+  // stack is storage for m_max_depth values, which needn't have been
+  // constructed
+  ValueExpected<Value> run(ExpressionEvaluationContext& evaluation_context,
+			   Value* stack) const;
+
+  std::pmr::vector<Instruction> m_code;
+  std::uint32_t m_depth;
+  std::uint32_t m_max_depth;
+};
+
+#endif // EXPRESSION_PROGRAM_HH
@@ -6,7 +6,9 @@
 #ifndef GRAMMAR_HH
 #define GRAMMAR_HH
 
+#include <charconv>
 #include <span>
+#include <string_view>
 
 #include <tao/pegtl.hpp>
 namespace pegtl = tao::pegtl;
@@ -39,8 +41,11 @@ namespace grammar
   struct hexadecimal_constant: pegtl::seq<pegtl::one<'$'>,
 					  pegtl::plus<xdigit>> {};
 
+  // A tab is allowed in character and string constants, as it was when
+  // tabs were expanded before parsing; see the actions.
   struct character_constant: pegtl::seq<pegtl::one<'\''>,
-					pegtl::ascii::print> {};
+					pegtl::sor<pegtl::ascii::print,
+						   pegtl::one<'\t'>>> {};
 
   struct string_constant_single_quote: pegtl::seq<pegtl::one<'\''>,
 						  pegtl::star<pegtl::not_one<'\''>>,
@@ -251,26 +256,99 @@ namespace grammar
 				    whitespace,
 				    symbol> {};
 
-  struct comment: pegtl::opt<pegtl::seq<whitespace,
+  struct comment: pegtl::opt<pegtl::seq<pegtl::opt<whitespace>,
 					pegtl::one<';'>,
 					pegtl::star<pegtl::any>>> {};
 
   struct statement_empty: pegtl::seq<> {};
 
-  struct statement: pegtl::seq<label,
-			       pegtl::sor<instruction_zero_operand,
-					  instruction_one_operand,
-					  pseudo_op_zero_operand,
-					  pseudo_op_variable_operand,
-					  pseudo_op_ascii,
-					  pseudo_op_def,
-					  pseudo_op_link,
-					  statement_empty>,
-			       comment> {};
+  // anything left over once no more of the line can be matched
+  struct unexpected_text: pegtl::plus<pegtl::any> {};
+
+  // as much of the line as can be matched as a statement
+  struct statement_body: pegtl::seq<label,
+				    pegtl::sor<instruction_zero_operand,
+					       instruction_one_operand,
+					       pseudo_op_zero_operand,
+					       pseudo_op_variable_operand,
+					       pseudo_op_ascii,
+					       pseudo_op_def,
+					       pseudo_op_link,
+					       statement_empty>,
+				    comment,
+				    pegtl::opt<whitespace>> {};
+
+  // The whole line must match, so that anything left over, such as an
+  // unrecognized mnemonic, is a syntax error rather than ignored.
+  struct statement: pegtl::seq<statement_body,
+			       pegtl::sor<pegtl::eof,
+					  unexpected_text>> {};
+
+  // Constants are converted directly from the matched input, without
+  // building a std::string; the digits have already been validated by
+  // the grammar, so the only possible failure is a value that doesn't
+  // fit in 16 bits. The constant's prefix, if any, is skipped.
+  inline std::uint16_t convert_constant(const Parser& parser,
+					std::string_view constant,
+					std::size_t prefix_length,
+					int base)
+  {
+    std::string_view digits = constant.substr(prefix_length);
+    unsigned long long value = 0;
+    auto [ptr, ec] = std::from_chars(digits.data(),
+				     digits.data() + digits.size(),
+				     value,
+				     base);
+    if ((ec != std::errc()) || (ptr != digits.data() + digits.size()) || (value > 0xffff))
+    {
+      throw ParseError(std::format("numeric constant \"{}\" out of range", digits),
+		       parser.get_column(constant.data()));
+    }
+    return static_cast<std::uint16_t>(value);
+  }
+
+  // Tabs in a string constant are expanded to spaces, up to the tab
+  // stops of the source line, into a copy in the AST arena.
+  inline std::string_view untabify_string_constant(Parser& parser,
+						   std::string_view s)
+  {
+    std::string_view line = parser.get_line();
+    std::size_t start_column = utility::untabified_column(line.substr(0, s.data() - line.data()));
+    std::size_t size = utility::untabified_column(s, start_column) - start_column;
+    char* p = static_cast<char*>(parser.get_ast_arena().get_memory_resource()->allocate(size, 1));
+    char* q = p;
+    for (char c: s)
+    {
+      if (c == '\t')
+      {
+	do
+	{
+	  *q++ = ' ';
+	}
+	while ((start_column + (q - p)) % utility::TAB_WIDTH);
+      }
+      else
+      {
+	*q++ = c;
+      }
+    }
+    return std::string_view(p, size);
+  }
 
   template<typename Rule>
   struct action: pegtl::nothing<Rule> {};
 
+  template<>
+  struct action<unexpected_text>
+  {
+    template<typename ActionInput>
+    static void apply(const ActionInput& in,
+		      Parser& parser)
+    {
+      throw ParseError("syntax error", parser.get_column(in.begin()));
+    }
+  };
+
   template<>
   struct action<expression_symbol>
   {
@@ -278,8 +356,8 @@ namespace grammar
     static void apply(const ActionInput& in,
 		      Parser& parser)
     {
-      auto symbol_sp = Symbol::create(utility::downcase_string(in.string()));
-      parser.m_ast_stack->push(symbol_sp);
+      auto symbol_ptr = Symbol::create(parser.get_ast_arena(), parser.intern_symbol(in.string_view()));
+      parser.m_ast_stack->push(symbol_ptr);
     }
   };
 
@@ -290,9 +368,9 @@ namespace grammar
     static void apply(const ActionInput& in,
 		      Parser& parser)
     {
-      unsigned long long value = std::stoull(in.begin() + 1, nullptr, 8);
-      auto constant_sp = Constant::create(value);
-      parser.m_ast_stack->push(constant_sp);
+      std::uint16_t value = convert_constant(parser, in.string_view(), 1, 8);
+      auto constant_ptr = Constant::create(parser.get_ast_arena(), value);
+      parser.m_ast_stack->push(constant_ptr);
     }
   };
 
@@ -303,9 +381,9 @@ namespace grammar
     static void apply(const ActionInput& in,
 		      Parser& parser)
     {
-      unsigned long long value = std::stoull(in.begin());
-      auto constant_sp = Constant::create(value);
-      parser.m_ast_stack->push(constant_sp);
+      std::uint16_t value = convert_constant(parser, in.string_view(), 0, 10);
+      auto constant_ptr = Constant::create(parser.get_ast_arena(), value);
+      parser.m_ast_stack->push(constant_ptr);
     }
   };
 
@@ -316,9 +394,9 @@ namespace grammar
     static void apply(const ActionInput& in,
 		      Parser& parser)
     {
-      unsigned long long value = std::stoull(in.begin() + 1, nullptr, 16);
-      auto constant_sp = Constant::create(value);
-      parser.m_ast_stack->push(constant_sp);
+      std::uint16_t value = convert_constant(parser, in.string_view(), 1, 16);
+      auto constant_ptr = Constant::create(parser.get_ast_arena(), value);
+      parser.m_ast_stack->push(constant_ptr);
     }
   };
 
@@ -329,9 +407,11 @@ namespace grammar
     static void apply(const ActionInput& in,
 		      Parser& parser)
     {
-      unsigned long long value = in.begin()[1];
-      auto constant_sp = Constant::create(value);
-      parser.m_ast_stack->push(constant_sp);
+      // a tab is the first of the spaces it expands to
+      char c = in.begin()[1];
+      unsigned long long value = (c == '\t') ? ' ' : c;
+      auto constant_ptr = Constant::create(parser.get_ast_arena(), value);
+      parser.m_ast_stack->push(constant_ptr);
     }
   };
 
@@ -342,10 +422,15 @@ namespace grammar
     static void apply(const ActionInput& in,
 		      Parser& parser)
     {
-      std::string s = in.string();
+      // the string constant refers to the source text, without quotes
+      std::string_view s = in.string_view();
       s = s.substr(1, s.size() - 2);
-      auto string_constant_sp = StringConstant::create(s);
-      parser.m_ast_stack->push(string_constant_sp);
+      if (s.find('\t') != std::string_view::npos)
+      {
+	s = untabify_string_constant(parser, s);
+      }
+      auto string_constant_ptr = StringConstant::create(parser.get_ast_arena(), s);
+      parser.m_ast_stack->push(string_constant_ptr);
     }
   };
 
@@ -356,135 +441,100 @@ namespace grammar
     static void apply([[maybe_unused]] const ActionInput& in,
 		      Parser& parser)
     {
-      // push constant XXX need a special AST node to handle this properly,
-      // e.g. for L'*
-      auto constant_sp = Constant::create(parser.get_location_counter());
-      parser.m_ast_stack->push(constant_sp);
+      // push location counter, which is resolved at evaluation time
+      auto location_counter_ptr = LocationCounter::create(parser.get_ast_arena());
+      parser.m_ast_stack->push(location_counter_ptr);
     }
   };
 
-  template<>
-  struct action<binary_adding_operator>
+  // The operator rules have no actions of their own. PEGTL doesn't
+  // undo an action when an enclosing rule later fails, so an operator
+  // pushed as soon as it matched would be left on the stack by an
+  // operand that doesn't, as in "foo+". Instead the operator is read
+  // back from the input of the rule that combines it with its operands.
+  inline UnaryOperatorEnum get_unary_operator_enum(char c)
   {
-    template<typename ActionInput>
-    static void apply([[maybe_unused]] const ActionInput& in,
-		      Parser& parser)
+    switch (c)
     {
-      BinaryOperatorEnum binary_operator_enum;
-      std::string s = in.string();
-      if (s == "+")
-      {
-	binary_operator_enum = BinaryOperatorEnum::ADDITION;
-      }
-      else if (s == "-")
-      {
-	binary_operator_enum = BinaryOperatorEnum::SUBTRACTION;
-      }
-      else
-      {
-	throw std::logic_error(std::format("internal error: unrecognized binary adding operator \"{}\"", s));
-      }
-      // push BinaryOperator
-      auto binary_operator = BinaryOperator::create(binary_operator_enum);
-      parser.m_ast_stack->push(binary_operator);
+    case '<':
+      return UnaryOperatorEnum::LOW_BYTE;
+    case '>':
+      return UnaryOperatorEnum::HIGH_BYTE;
+    default:
+      throw std::logic_error(std::format("internal error: unrecognized unary operator \"{}\"", c));
     }
-  };
+  }
 
-  template<>
-  struct action<unary_operator>
+  inline BinaryOperatorEnum get_binary_operator_enum(char c)
   {
-    template<typename ActionInput>
-    static void apply([[maybe_unused]] const ActionInput& in,
-		      Parser& parser)
+    switch (c)
     {
-      UnaryOperatorEnum unary_operator_enum;
-      std::string s = in.string();
-      if (s == "<")
-      {
-	unary_operator_enum = UnaryOperatorEnum::LOW_BYTE;
-      }
-      else if (s == ">")
-      {
-	unary_operator_enum = UnaryOperatorEnum::HIGH_BYTE;
-      }
-      else
-      {
-	throw std::logic_error(std::format("internal error: unrecognized unary operator \"{}\"", s));
-      }
-      // push UnaryOperator
-      auto unary_operator = UnaryOperator::create(unary_operator_enum);
-      parser.m_ast_stack->push(unary_operator);
+    case '+':
+      return BinaryOperatorEnum::ADDITION;
+    case '-':
+      return BinaryOperatorEnum::SUBTRACTION;
+    case '*':
+      return BinaryOperatorEnum::MULTIPLICATION;
+    case '/':
+      return BinaryOperatorEnum::DIVISION;
+    default:
+      throw std::logic_error(std::format("internal error: unrecognized binary operator \"{}\"", c));
     }
-  };
+  }
 
   template<>
   struct action<unary_expression>
   {
     template<typename ActionInput>
-    static void apply([[maybe_unused]] const ActionInput& in,
+    static void apply(const ActionInput& in,
 		      Parser& parser)
     {
       // pop operand Expression
-      auto operand_expression_sp = parser.m_ast_stack->pop<Expression>();
+      auto operand_expression_ptr = parser.m_ast_stack->pop<Expression>();
 
-      // pop UnaryOperator
-      auto unary_operator = parser.m_ast_stack->pop<UnaryOperator>();
+      // the operator is the first character of the unary expression
+      auto unary_operator = UnaryOperator::create(parser.get_ast_arena(),
+						  get_unary_operator_enum(*in.begin()));
 
       // push UnaryOperatorExpression
-      auto unary_operator_expression_sp = UnaryOperatorExpression::create(unary_operator,
-									  operand_expression_sp);
-      parser.m_ast_stack->push(unary_operator_expression_sp);
+      auto unary_operator_expression_ptr = UnaryOperatorExpression::create(parser.get_ast_arena(),
+									   unary_operator,
+									   operand_expression_ptr);
+      parser.m_ast_stack->push(unary_operator_expression_ptr);
     }
   };
 
-  template<>
-  struct action<binary_multiplying_operator>
+  // Shared by the multiplying and adding operators; the operator is the
+  // first character of the rule's input.
+  template<typename ActionInput>
+  void apply_binary_operator(const ActionInput& in,
+			     Parser& parser)
   {
-    template<typename ActionInput>
-    static void apply([[maybe_unused]] const ActionInput& in,
-		      Parser& parser)
-    {
-      BinaryOperatorEnum binary_operator_enum;
-      std::string s = in.string();
-      if (s == "*")
-      {
-	binary_operator_enum = BinaryOperatorEnum::MULTIPLICATION;
-      }
-      else if (s == "/")
-      {
-	binary_operator_enum = BinaryOperatorEnum::DIVISION;
-      }
-      else
-      {
-	throw std::logic_error(std::format("internal error: unrecognized binary multiplying operator \"{}\"", s));
-      }
-      // push BinaryOperator
-      auto binary_operator = BinaryOperator::create(binary_operator_enum);
-      parser.m_ast_stack->push(binary_operator);
-    }
-  };
+    // pop second operand Expression
+    auto second_operand_expression_ptr = parser.m_ast_stack->pop<Expression>();
+
+    auto binary_operator = BinaryOperator::create(parser.get_ast_arena(),
+						  get_binary_operator_enum(*in.begin()));
+
+    // pop first operand Expression
+    auto first_operand_expression_ptr = parser.m_ast_stack->pop<Expression>();
+
+    // push BinaryOperatorExpression
+    auto binary_operator_expression_ptr = BinaryOperatorExpression::create(parser.get_ast_arena(),
+									   first_operand_expression_ptr,
+									   binary_operator,
+									   second_operand_expression_ptr);
+    parser.m_ast_stack->push(binary_operator_expression_ptr);
+  }
 
   template<>
   struct action<term_additional_factor>
   {
     template<typename ActionInput>
-    static void apply([[maybe_unused]] const ActionInput& in,
+    static void apply(const ActionInput& in,
 		      Parser& parser)
     {
-      // pop second operand Expression
-      auto second_operand_expression_sp = parser.m_ast_stack->pop<Expression>();
-
-      // pop BinaryOperator
-      auto binary_operator = parser.m_ast_stack->pop<BinaryOperator>();
-
-      // pop first operand Exprssion
-      auto first_operand_expression_sp = parser.m_ast_stack->pop<Expression>();
-
-      // push BinaryOperatorExpression
-      auto binary_operator_expression_sp = BinaryOperatorExpression::create(first_operand_expression_sp,
-									    binary_operator,
-									    second_operand_expression_sp);
-      parser.m_ast_stack->push(binary_operator_expression_sp);
+      apply_binary_operator(in, parser);
     }
   };
 
@@ -492,23 +542,10 @@ namespace grammar
   struct action<expression_additional_term>
   {
     template<typename ActionInput>
-    static void apply([[maybe_unused]] const ActionInput& in,
+    static void apply(const ActionInput& in,
 		      Parser& parser)
     {
-      // pop second operand Expression
-      auto second_operand_expression_sp = parser.m_ast_stack->pop<Expression>();
-
-      // pop BinaryOperator
-      auto binary_operator = parser.m_ast_stack->pop<BinaryOperator>();
-
-      // pop first operand Exprssion
-      auto first_operand_expression_sp = parser.m_ast_stack->pop<Expression>();
-
-      // push BinaryOperatorExpression
-      auto binary_operator_expression_sp = BinaryOperatorExpression::create(first_operand_expression_sp,
-									    binary_operator,
-									    second_operand_expression_sp);
-      parser.m_ast_stack->push(binary_operator_expression_sp);
+      apply_binary_operator(in, parser);
     }
   };
 
@@ -520,12 +557,12 @@ namespace grammar
 		      Parser& parser)
     {
       // pop expression
-      auto expression_sp = parser.m_ast_stack->pop<Expression>();
+      auto expression_ptr = parser.m_ast_stack->pop<Expression>();
 
       // push expression list
-      auto expression_list_sp = ExpressionList::create();
-      expression_list_sp->append_expression(expression_sp);
-      parser.m_ast_stack->push(expression_list_sp);
+      auto expression_list_ptr = ExpressionList::create(parser.get_ast_arena());
+      expression_list_ptr->append_expression(expression_ptr);
+      parser.m_ast_stack->push(expression_list_ptr);
     }
   };
 
@@ -537,11 +574,11 @@ namespace grammar
 		      Parser& parser)
     {
       // pop expression
-      auto expression_sp = parser.m_ast_stack->pop<Expression>();
+      auto expression_ptr = parser.m_ast_stack->pop<Expression>();
 
       // peek expression list
-      auto expression_list_sp = parser.m_ast_stack->peek_top<ExpressionList>();
-      expression_list_sp->append_expression(expression_sp);
+      auto expression_list_ptr = parser.m_ast_stack->peek_top<ExpressionList>();
+      expression_list_ptr->append_expression(expression_ptr);
     }
   };
 
@@ -553,8 +590,8 @@ namespace grammar
 		      Parser& parser)
     {
       // push expression list
-      auto expression_list_sp = ExpressionList::create();
-      parser.m_ast_stack->push(expression_list_sp);
+      auto expression_list_ptr = ExpressionList::create(parser.get_ast_arena());
+      parser.m_ast_stack->push(expression_list_ptr);
     }
   };
 
@@ -566,8 +603,8 @@ namespace grammar
 		      Parser& parser)
     {
       // push empty symbol
-      auto symbol_sp = Symbol::create("");
-      parser.m_ast_stack->push(symbol_sp);
+      auto symbol_ptr = Symbol::create(parser.get_ast_arena(), SymbolTable::NO_SYMBOL);
+      parser.m_ast_stack->push(symbol_ptr);
     }
   };
 
@@ -578,10 +615,10 @@ namespace grammar
     static void apply(const ActionInput& in,
 		      Parser& parser)
     {
-      const std::string& s = in.string();
+      std::string_view s = in.string_view();
       // push symbol
-      auto symbol_sp = Symbol::create(utility::downcase_string(s.substr(0, s.size() - 1)));
-      parser.m_ast_stack->push(symbol_sp);
+      auto symbol_ptr = Symbol::create(parser.get_ast_arena(), parser.intern_symbol(s.substr(0, s.size() - 1)));
+      parser.m_ast_stack->push(symbol_ptr);
     }
   };
 
@@ -592,9 +629,9 @@ namespace grammar
     static void apply(const ActionInput& in,
 		      Parser& parser)
     {
-      // push Mnemonic
-      std::string m = in.string();
-      parser.m_ast_stack->push(Mnemonic::create(m));
+      // push Mnemonic, resolved to its instruction set entries
+      std::string_view m = in.string_view();
+      parser.m_ast_stack->push(Mnemonic::create(parser.get_ast_arena(), m, parser.find_instruction_info(m)));
     }
   };
 
@@ -605,76 +642,37 @@ namespace grammar
     static void apply(const ActionInput& in,
 		      Parser& parser)
     {
-      // push Mnemonic
-      std::string m = in.string();
-      parser.m_ast_stack->push(Mnemonic::create(m));
-    }
-  };
-
-  template<>
-  struct action<mnemonic_pseudo_zero_operand>
-  {
-    template<typename ActionInput>
-    static void apply(const ActionInput& in,
-		      Parser& parser)
-    {
-      // push Mnemonic
-      std::string m = in.string();
-      parser.m_ast_stack->push(Mnemonic::create(m));
-    }
-  };
-
-  template<>
-  struct action<mnemonic_pseudo_variable_operand>
-  {
-    template<typename ActionInput>
-    static void apply(const ActionInput& in,
-		      Parser& parser)
-    {
-      // push Mnemonic
-      std::string m = in.string();
-      parser.m_ast_stack->push(Mnemonic::create(m));
-    }
-  };
-
-  template<>
-  struct action<mnemonic_pseudo_ascii>
-  {
-    template<typename ActionInput>
-    static void apply(const ActionInput& in,
-		      Parser& parser)
-    {
-      // push Mnemonic
-      std::string m = in.string();
-      parser.m_ast_stack->push(Mnemonic::create(m));
+      // push Mnemonic, resolved to its instruction set entries
+      std::string_view m = in.string_view();
+      parser.m_ast_stack->push(Mnemonic::create(parser.get_ast_arena(), m, parser.find_instruction_info(m)));
     }
   };
 
-  template<>
-  struct action<mnemonic_pseudo_def>
+  // pseudo-op mnemonics are resolved by which rule matched
+  template<PseudoOp::PseudoOpEnum PSEUDO_OP>
+  struct pseudo_op_mnemonic_action
   {
     template<typename ActionInput>
     static void apply(const ActionInput& in,
 		      Parser& parser)
     {
       // push Mnemonic
-      std::string m = in.string();
-      parser.m_ast_stack->push(Mnemonic::create(m));
+      std::string_view m = in.string_view();
+      parser.m_ast_stack->push(Mnemonic::create(parser.get_ast_arena(), m, PSEUDO_OP));
     }
   };
 
-  template<>
-  struct action<mnemonic_pseudo_link>
-  {
-    template<typename ActionInput>
-    static void apply(const ActionInput& in,
-		      Parser& parser)
-    {
-      // push Mnemonic
-      std::string m = in.string();
-      parser.m_ast_stack->push(Mnemonic::create(m));
-    }
-  };
+  template<> struct action<mnemonic_pseudo_ascii>:  pseudo_op_mnemonic_action<PseudoOp::PseudoOpEnum::ASCII>  {};
+  template<> struct action<mnemonic_pseudo_byte>:   pseudo_op_mnemonic_action<PseudoOp::PseudoOpEnum::BYTE>   {};
+  template<> struct action<mnemonic_pseudo_def>:    pseudo_op_mnemonic_action<PseudoOp::PseudoOpEnum::DEF>    {};
+  template<> struct action<mnemonic_pseudo_end>:    pseudo_op_mnemonic_action<PseudoOp::PseudoOpEnum::END>    {};
+  template<> struct action<mnemonic_pseudo_hbyte>:  pseudo_op_mnemonic_action<PseudoOp::PseudoOpEnum::HBYTE>  {};
+  template<> struct action<mnemonic_pseudo_link>:   pseudo_op_mnemonic_action<PseudoOp::PseudoOpEnum::LINK>   {};
+  template<> struct action<mnemonic_pseudo_list>:   pseudo_op_mnemonic_action<PseudoOp::PseudoOpEnum::LIST>   {};
+  template<> struct action<mnemonic_pseudo_loc>:    pseudo_op_mnemonic_action<PseudoOp::PseudoOpEnum::LOC>    {};
+  template<> struct action<mnemonic_pseudo_nolist>: pseudo_op_mnemonic_action<PseudoOp::PseudoOpEnum::NOLIST> {};
+  template<> struct action<mnemonic_pseudo_page>:   pseudo_op_mnemonic_action<PseudoOp::PseudoOpEnum::PAGE>   {};
+  template<> struct action<mnemonic_pseudo_word>:   pseudo_op_mnemonic_action<PseudoOp::PseudoOpEnum::WORD>   {};
 
   template<>
   struct action<instruction_zero_operand>
@@ -684,12 +682,12 @@ namespace grammar
 		      [[maybe_unused]] Parser& parser)
     {
       // pop mnemonic
-      auto mnemonic_sp = parser.m_ast_stack->pop<Mnemonic>();
+      auto mnemonic_ptr = parser.m_ast_stack->pop<Mnemonic>();
 
       // push statement
-      auto statement_sp = Statement::create();
-      statement_sp->set_mnemonic(mnemonic_sp->get());
-      parser.m_ast_stack->push(statement_sp);
+      auto statement_ptr = Statement::create(parser.get_ast_arena());
+      statement_ptr->set_mnemonic(mnemonic_ptr);
+      parser.m_ast_stack->push(statement_ptr);
     }
   };
 
@@ -701,16 +699,16 @@ namespace grammar
 		      [[maybe_unused]] Parser& parser)
     {
       // pop operand
-      auto operand_sp = parser.m_ast_stack->pop<Expression>();
+      auto operand_ptr = parser.m_ast_stack->pop<Expression>();
 
       // pop mnemonic
-      auto mnemonic_sp = parser.m_ast_stack->pop<Mnemonic>();
+      auto mnemonic_ptr = parser.m_ast_stack->pop<Mnemonic>();
 
       // push statement
-      auto statement_sp = Statement::create();
-      statement_sp->set_mnemonic(mnemonic_sp->get());
-      statement_sp->add_operand(operand_sp);
-      parser.m_ast_stack->push(statement_sp);
+      auto statement_ptr = Statement::create(parser.get_ast_arena());
+      statement_ptr->set_mnemonic(mnemonic_ptr);
+      statement_ptr->add_operand(operand_ptr);
+      parser.m_ast_stack->push(statement_ptr);
     }
   };
 
@@ -722,12 +720,12 @@ namespace grammar
 		      [[maybe_unused]] Parser& parser)
     {
       // pop mnemonic
-      auto mnemonic_sp = parser.m_ast_stack->pop<Mnemonic>();
+      auto mnemonic_ptr = parser.m_ast_stack->pop<Mnemonic>();
 
       // push statement
-      auto statement_sp = Statement::create();
-      statement_sp->set_mnemonic(mnemonic_sp->get());
-      parser.m_ast_stack->push(statement_sp);
+      auto statement_ptr = Statement::create(parser.get_ast_arena());
+      statement_ptr->set_mnemonic(mnemonic_ptr);
+      parser.m_ast_stack->push(statement_ptr);
     }
   };
 
@@ -739,16 +737,16 @@ namespace grammar
 		      [[maybe_unused]] Parser& parser)
     {
       // pop operands
-      auto operands_sp = parser.m_ast_stack->pop<ExpressionList>();
+      auto operands_ptr = parser.m_ast_stack->pop<ExpressionList>();
 
       // pop mnemonic
-      auto mnemonic_sp = parser.m_ast_stack->pop<Mnemonic>();
+      auto mnemonic_ptr = parser.m_ast_stack->pop<Mnemonic>();
 
       // push statement
-      auto statement_sp = Statement::create();
-      statement_sp->set_mnemonic(mnemonic_sp->get());
-      statement_sp->set_operands(operands_sp->get());
-      parser.m_ast_stack->push(statement_sp);
+      auto statement_ptr = Statement::create(parser.get_ast_arena());
+      statement_ptr->set_mnemonic(mnemonic_ptr);
+      statement_ptr->set_operands(operands_ptr->get());
+      parser.m_ast_stack->push(statement_ptr);
     }
   };
 
@@ -760,16 +758,16 @@ namespace grammar
 		      [[maybe_unused]] Parser& parser)
     {
       // pop operand
-      auto operand_sp = parser.m_ast_stack->pop<Expression>();
+      auto operand_ptr = parser.m_ast_stack->pop<Expression>();
 
       // pop mnemonic
-      auto mnemonic_sp = parser.m_ast_stack->pop<Mnemonic>();
+      auto mnemonic_ptr = parser.m_ast_stack->pop<Mnemonic>();
 
       // push statement
-      auto statement_sp = Statement::create();
-      statement_sp->set_mnemonic(mnemonic_sp->get());
-      statement_sp->add_operand(operand_sp);
-      parser.m_ast_stack->push(statement_sp);
+      auto statement_ptr = Statement::create(parser.get_ast_arena());
+      statement_ptr->set_mnemonic(mnemonic_ptr);
+      statement_ptr->add_operand(operand_ptr);
+      parser.m_ast_stack->push(statement_ptr);
     }
   };
 
@@ -781,18 +779,18 @@ namespace grammar
 		      [[maybe_unused]] Parser& parser)
     {
       // pop operands
-      auto operand2_sp = parser.m_ast_stack->pop<Expression>();
-      auto operand1_sp = parser.m_ast_stack->pop<Expression>();
+      auto operand2_ptr = parser.m_ast_stack->pop<Expression>();
+      auto operand1_ptr = parser.m_ast_stack->pop<Expression>();
 
       // pop mnemonic
-      auto mnemonic_sp = parser.m_ast_stack->pop<Mnemonic>();
+      auto mnemonic_ptr = parser.m_ast_stack->pop<Mnemonic>();
 
       // push statement
-      auto statement_sp = Statement::create();
-      statement_sp->set_mnemonic(mnemonic_sp->get());
-      statement_sp->add_operand(operand1_sp);
-      statement_sp->add_operand(operand2_sp);
-      parser.m_ast_stack->push(statement_sp);
+      auto statement_ptr = Statement::create(parser.get_ast_arena());
+      statement_ptr->set_mnemonic(mnemonic_ptr);
+      statement_ptr->add_operand(operand1_ptr);
+      statement_ptr->add_operand(operand2_ptr);
+      parser.m_ast_stack->push(statement_ptr);
     }
   };
 
@@ -804,9 +802,8 @@ namespace grammar
 		      Parser& parser)
     {
       // push statement
-      auto statement_sp = Statement::create();
-      statement_sp->set_mnemonic("");
-      parser.m_ast_stack->push(statement_sp);
+      auto statement_ptr = Statement::create(parser.get_ast_arena());
+      parser.m_ast_stack->push(statement_ptr);
     }
   };
 
@@ -818,16 +815,16 @@ namespace grammar
 		      [[maybe_unused]] Parser& parser)
     {
       // pop statement
-      auto statement_sp = parser.m_ast_stack->pop<Statement>();
+      auto statement_ptr = parser.m_ast_stack->pop<Statement>();
 
       // pop label
-      auto label_sp = parser.m_ast_stack->pop<Symbol>();
+      auto label_ptr = parser.m_ast_stack->pop<Symbol>();
 
       // peek statement
-      statement_sp->set_label(label_sp->get());
+      statement_ptr->set_label(label_ptr->get());
 
       // push statement
-      parser.m_ast_stack->push(statement_sp);
+      parser.m_ast_stack->push(statement_ptr);
     }
   };
 
@@ -3,17 +3,18 @@
 // Copyright 2025 Eric Smith
 // SPDX-License-Identifier: GPL-3.0-only
 
-#include <bitset>
+#include <array>
 #include <format>
+#include <iterator>
 #include <stdexcept>
 
 #include "instruction_set.hh"
-#include "utility.hh"
+#include "perfect_hash.hh"
 
 using enum InstructionSet::Set;
 using enum InstructionSet::Mode;
 
-const magic_enum::containers::array<InstructionSet::Mode, std::uint8_t> s_operand_size_bytes
+constexpr magic_enum::containers::array<InstructionSet::Mode, std::uint8_t> s_operand_size_bytes
 {
   /* IMPLIED      */ 0,
   /* ACCUMULATOR  */ 0,
@@ -30,7 +31,7 @@ const magic_enum::containers::array<InstructionSet::Mode, std::uint8_t> s_operan
   /* RELATIVE     */ 1,
 };
 
-const magic_enum::containers::array<InstructionSet::Mode, std::string> s_mos_address_mode_prefixes
+constexpr magic_enum::containers::array<InstructionSet::Mode, std::string_view> s_mos_address_mode_prefixes
 {
   /* IMPLIED      */ "",
   /* ACCUMULATOR  */ "",
@@ -47,7 +48,7 @@ const magic_enum::containers::array<InstructionSet::Mode, std::string> s_mos_add
   /* RELATIVE     */ "",
 };
 
-const magic_enum::containers::array<InstructionSet::Mode, std::string> s_mos_address_mode_suffixes
+constexpr magic_enum::containers::array<InstructionSet::Mode, std::string_view> s_mos_address_mode_suffixes
 {
   /* IMPLIED      */ "",
   /* ACCUMULATOR  */ "",
@@ -64,7 +65,7 @@ const magic_enum::containers::array<InstructionSet::Mode, std::string> s_mos_add
   /* RELATIVE     */ "",
 };
 
-const magic_enum::containers::array<InstructionSet::Mode, std::string> s_pal65_address_mode_suffixes
+constexpr magic_enum::containers::array<InstructionSet::Mode, std::string_view> s_pal65_address_mode_suffixes
 {
   /* IMPLIED      */ "",
   /* ACCUMULATOR  */ "a",
@@ -81,7 +82,7 @@ const magic_enum::containers::array<InstructionSet::Mode, std::string> s_pal65_a
   /* RELATIVE     */ "",
 };
 
-const std::vector<InstructionSet::Info> s_main_table
+constexpr InstructionSet::Info s_main_table[]
 {
   { "adc", BASE, IMMEDIATE,    0x69 },
   { "adc", BASE, ZERO_PAGE,    0x65 },
@@ -288,53 +289,190 @@ const std::vector<InstructionSet::Info> s_main_table
   { "tya", BASE, IMPLIED,      0x98 },
 };
 
-InstructionSet::UnrecognizedMnemonic::UnrecognizedMnemonic(const std::string& mnemonic):
-  std::runtime_error(std::format("unrecognized mnemonic {}", mnemonic))
+constexpr std::size_t MAIN_TABLE_SIZE = std::size(s_main_table);
+
+constexpr perfect_hash::Key pal65_spelling(const InstructionSet::Info& info)
 {
+  return perfect_hash::Key(info.mnemonic, s_pal65_address_mode_suffixes[info.mode]);
 }
 
-std::shared_ptr<InstructionSet> InstructionSet::create()
+constexpr bool pal65_compatible_modes(InstructionSet::Mode m1, InstructionSet::Mode m2)
 {
-  auto p = new InstructionSet();
-  return std::shared_ptr<InstructionSet>(p);
+  return (((m1 == ZERO_PAGE)   && (m2 == ABSOLUTE))   ||
+	  ((m1 == ABSOLUTE)    && (m2 == ZERO_PAGE))  ||
+	  ((m1 == ZERO_PAGE_X) && (m2 == ABSOLUTE_X)) ||
+	  ((m1 == ABSOLUTE_X)  && (m2 == ZERO_PAGE_X)) ||
+	  ((m1 == ZERO_PAGE_Y) && (m2 == ABSOLUTE_Y)) ||
+	  ((m1 == ABSOLUTE_Y)  && (m2 == ZERO_PAGE_Y)));
 }
 
-InstructionSet::InstructionSet()
+constexpr bool opcodes_unique()
 {
-  std::bitset<0x100> opcode_used;
+  std::array<bool, 0x100> opcode_used {};
   for (const auto& info: s_main_table)
   {
-    std::string pal65_mnemonic = info.mnemonic + s_pal65_address_mode_suffixes[info.mode];
     if (opcode_used[info.opcode])
     {
-      throw std::logic_error(std::format("duplicate opcode {:02x}", info.opcode));
+      return false;
     }
     opcode_used[info.opcode] = true;
-    if (m_by_mnemonic.contains(pal65_mnemonic))
+  }
+  return true;
+}
+
+static_assert(opcodes_unique(), "duplicate opcode in instruction table");
+
+constexpr std::size_t count_pal65_spellings()
+{
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < MAIN_TABLE_SIZE; i++)
+  {
+    std::size_t j = 0;
+    while (pal65_spelling(s_main_table[j]) != pal65_spelling(s_main_table[i]))
+    {
+      j++;
+    }
+    if (j == i)
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+constexpr std::size_t PAL65_SPELLING_COUNT = count_pal65_spellings();
+
+// The main table regrouped so that all of the entries for a PAL65
+// spelling are adjacent, in their original order. Spelling n has
+// entries group_start[n] through group_start[n + 1] - 1.
+struct Pal65Groups
+{
+  std::array<InstructionSet::Info, MAIN_TABLE_SIZE> infos;
+  std::array<perfect_hash::Key, PAL65_SPELLING_COUNT> spellings;
+  std::array<std::uint16_t, PAL65_SPELLING_COUNT + 1> group_start;
+};
+
+constexpr Pal65Groups group_by_pal65_spelling()
+{
+  Pal65Groups groups {};
+  std::size_t info_count = 0;
+  std::size_t spelling_count = 0;
+  for (std::size_t i = 0; i < MAIN_TABLE_SIZE; i++)
+  {
+    perfect_hash::Key spelling = pal65_spelling(s_main_table[i]);
+    bool seen = false;
+    for (std::size_t j = 0; j < spelling_count; j++)
+    {
+      seen = seen || (groups.spellings[j] == spelling);
+    }
+    if (seen)
+    {
+      continue;
+    }
+    groups.spellings[spelling_count] = spelling;
+    groups.group_start[spelling_count++] = static_cast<std::uint16_t>(info_count);
+    for (std::size_t j = i; j < MAIN_TABLE_SIZE; j++)
     {
-      if (! pal65_compatible_modes(m_by_mnemonic.at(pal65_mnemonic).at(0).mode, info.mode))
+      if (pal65_spelling(s_main_table[j]) == spelling)
       {
-	throw std::logic_error(std::format("duplicate PAL65 mnemonic {}", pal65_mnemonic));
+	groups.infos[info_count++] = s_main_table[j];
       }
     }
-    m_by_mnemonic[pal65_mnemonic].push_back(info);
   }
+  groups.group_start[spelling_count] = static_cast<std::uint16_t>(info_count);
+  return groups;
+}
+
+constexpr Pal65Groups s_pal65_groups = group_by_pal65_spelling();
+
+// Multiple entries for one PAL65 spelling are only allowed for a zero
+// page mode followed by the corresponding absolute mode, which the
+// assembler chooses between based on the operand value.
+constexpr bool pal65_groups_valid()
+{
+  for (std::size_t n = 0; n < PAL65_SPELLING_COUNT; n++)
+  {
+    std::size_t start = s_pal65_groups.group_start[n];
+    std::size_t count = s_pal65_groups.group_start[n + 1] - start;
+    if (count == 1)
+    {
+      continue;
+    }
+    if (count != 2)
+    {
+      return false;
+    }
+    InstructionSet::Mode m1 = s_pal65_groups.infos[start].mode;
+    InstructionSet::Mode m2 = s_pal65_groups.infos[start + 1].mode;
+    if ((! pal65_compatible_modes(m1, m2)) ||
+	(s_operand_size_bytes[m1] != 1) ||
+	(s_operand_size_bytes[m2] != 2))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(pal65_groups_valid(), "duplicate PAL65 mnemonic with incompatible address modes");
+
+constexpr perfect_hash::Table<PAL65_SPELLING_COUNT> s_pal65_hash(s_pal65_groups.spellings);
+
+constexpr bool pal65_hash_complete()
+{
+  for (std::size_t n = 0; n < PAL65_SPELLING_COUNT; n++)
+  {
+    if (s_pal65_hash.find(s_pal65_groups.spellings[n].view()) != n)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(pal65_hash_complete());
+
+InstructionSet::UnrecognizedMnemonic::UnrecognizedMnemonic(std::string_view mnemonic):
+  std::runtime_error(std::format("unrecognized mnemonic {}", mnemonic))
+{
+}
+
+std::shared_ptr<InstructionSet> InstructionSet::create()
+{
+  auto p = new InstructionSet();
+  return std::shared_ptr<InstructionSet>(p);
+}
+
+InstructionSet::InstructionSet()
+{
+  // all tables are built and checked at compile time
 }
 
-bool InstructionSet::valid_mnemonic(const std::string& mnemonic) const
+bool InstructionSet::valid_mnemonic(std::string_view mnemonic) const
 {
-  std::string s = utility::downcase_string(mnemonic);
-  return m_by_mnemonic.contains(s);
+  return s_pal65_hash.find(mnemonic) != perfect_hash::NOT_FOUND;
 }
 
-const std::vector<InstructionSet::Info>& InstructionSet::get(const std::string& mnemonic) const
+std::span<const InstructionSet::Info> InstructionSet::get(std::string_view mnemonic) const
 {
-  std::string s = utility::downcase_string(mnemonic);
-  if (! m_by_mnemonic.contains(s))
+  std::span<const Info> infos = find(mnemonic);
+  if (infos.empty())
   {
     throw UnrecognizedMnemonic(mnemonic);
   }
-  return m_by_mnemonic.at(s);
+  return infos;
+}
+
+std::span<const InstructionSet::Info> InstructionSet::find(std::string_view mnemonic) const
+{
+  std::size_t n = s_pal65_hash.find(mnemonic);
+  if (n == perfect_hash::NOT_FOUND)
+  {
+    return {};
+  }
+  std::size_t start = s_pal65_groups.group_start[n];
+  std::size_t count = s_pal65_groups.group_start[n + 1] - start;
+  return std::span<const Info>(s_pal65_groups.infos).subspan(start, count);
 }
 
 std::uint32_t InstructionSet::get_length(Mode mode)
@@ -376,20 +514,5 @@ std::uint8_t InstructionSet::operand_size_bytes(Mode mode)
 
 bool InstructionSet::pal65_compatible_modes(Mode m1, Mode m2)
 {
-  if (((m1 == ZERO_PAGE) && (m2 == ABSOLUTE)) ||
-      ((m1 == ABSOLUTE)  && (m2 == ZERO_PAGE)))
-  {
-    return true;
-  }
-  if (((m1 == ZERO_PAGE_X) && (m2 == ABSOLUTE_X)) ||
-      ((m1 == ABSOLUTE_X)  && (m2 == ZERO_PAGE_X)))
-  {
-    return true;
-  }
-  if (((m1 == ZERO_PAGE_Y) && (m2 == ABSOLUTE_Y)) ||
-      ((m1 == ABSOLUTE_Y)  && (m2 == ZERO_PAGE_Y)))
-  {
-    return true;
-  }
-  return false;
+  return ::pal65_compatible_modes(m1, m2);
 }
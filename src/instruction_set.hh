@@ -7,9 +7,10 @@
 #define INSTRUCTION_SET_HH
 
 #include <cstdint>
-#include <map>
 #include <memory>
-#include <string>
+#include <span>
+#include <stdexcept>
+#include <string_view>
 
 #include <magic_enum.hpp>
 #include <magic_enum_containers.hpp>
@@ -22,7 +23,7 @@ public:
   class UnrecognizedMnemonic: public std::runtime_error
   {
   public:
-    UnrecognizedMnemonic(const std::string& mnemonic);
+    UnrecognizedMnemonic(std::string_view mnemonic);
   };
 
   enum class Set
@@ -55,15 +56,23 @@ public:
 
   struct Info
   {
-    const std::string mnemonic;
+    std::string_view mnemonic;
     Set set;
     Mode mode;
     std::uint8_t opcode;
   };
 
-  bool valid_mnemonic(const std::string& mnemonic) const;
+  // Mnemonics are PAL65 spellings, including any address mode suffix,
+  // and are matched case-insensitively. The lookup table is a perfect
+  // hash built at compile time.
+  bool valid_mnemonic(std::string_view mnemonic) const;
 
-  const std::vector<Info>& get(const std::string& mnemonic) const;
+  // Returns one entry, or two for a mnemonic that has both zero page
+  // and absolute forms, in that order.
+  std::span<const Info> get(std::string_view mnemonic) const;
+
+  // as get(), but returns an empty span if the mnemonic is unrecognized
+  std::span<const Info> find(std::string_view mnemonic) const;
 
   static std::uint8_t operand_size_bytes(Mode mode);
 
@@ -71,8 +80,6 @@ public:
 
 protected:
   InstructionSet();
-
-  std::map<std::string, std::vector<Info>> m_by_mnemonic;
 };
 
 #endif // INSTRUCTION_SET_HH
@@ -0,0 +1,105 @@
+// line_table.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "line_table.hh"
+
+std::shared_ptr<LineTable> LineTable::create(std::size_t line_count)
+{
+  auto p = new LineTable(line_count);
+  return std::shared_ptr<LineTable>(p);
+}
+
+LineTable::LineTable(std::size_t line_count):
+  m_addresses(line_count),
+  m_offsets(line_count),
+  m_lengths(line_count),
+  m_word_starts(line_count),
+  m_flags(line_count),
+  m_listing_controls(line_count, Listing::Control::NONE)
+{
+}
+
+std::size_t LineTable::size() const
+{
+  return m_addresses.size();
+}
+
+// The previous pool's capacity is reused.
+void LineTable::start_pass()
+{
+  m_pool.swap(m_previous_pool);
+  m_pool.clear();
+}
+
+std::vector<std::uint8_t>& LineTable::get_pool()
+{
+  return m_pool;
+}
+
+void LineTable::record(std::size_t index,
+		       std::uint16_t address,
+		       std::uint32_t offset,
+		       std::uint32_t length,
+		       std::uint32_t word_starts,
+		       std::uint8_t flags,
+		       Listing::Control listing_control)
+{
+  m_addresses[index]        = address;
+  m_offsets[index]          = offset;
+  m_lengths[index]          = length;
+  m_word_starts[index]      = word_starts;
+  m_flags[index]            = flags;
+  m_listing_controls[index] = listing_control;
+}
+
+void LineTable::rebase(std::size_t begin,
+		       std::size_t end,
+		       std::uint32_t base)
+{
+  for (std::size_t index = begin; index < end; index++)
+  {
+    m_offsets[index] += base;
+  }
+}
+
+std::uint16_t LineTable::get_address(std::size_t index) const
+{
+  return m_addresses[index];
+}
+
+std::uint32_t LineTable::get_length(std::size_t index) const
+{
+  return m_lengths[index];
+}
+
+std::uint32_t LineTable::get_word_starts(std::size_t index) const
+{
+  return m_word_starts[index];
+}
+
+std::uint8_t LineTable::get_flags(std::size_t index) const
+{
+  return m_flags[index];
+}
+
+Listing::Control LineTable::get_listing_control(std::size_t index) const
+{
+  return m_listing_controls[index];
+}
+
+std::span<const std::uint8_t> LineTable::get_object_code(std::size_t index) const
+{
+  return std::span<const std::uint8_t>(m_pool).subspan(m_offsets[index], m_lengths[index]);
+}
+
+std::span<std::uint8_t> LineTable::get_object_code(std::size_t index)
+{
+  return std::span<std::uint8_t>(m_pool).subspan(m_offsets[index], m_lengths[index]);
+}
+
+std::span<const std::uint8_t> LineTable::get_previous_object_code(std::size_t index) const
+{
+  return std::span<const std::uint8_t>(m_previous_pool).subspan(m_offsets[index], m_lengths[index]);
+}
@@ -0,0 +1,96 @@
+// line_table.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef LINE_TABLE_HH
+#define LINE_TABLE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "listing.hh"
+
+// The output of each source line, from the last pass that assembled
+// it, kept for the whole source file as a structure of arrays indexed
+// by line. The object code of the lines is kept in a single byte
+// pool, which is appended to in line order as a pass runs, so the
+// object code of a range of lines is contiguous. The pool of the
+// previous pass is kept until the end of the next, so that lines can
+// be replayed from it.
+class LineTable
+{
+public:
+  // flags
+  static constexpr std::uint8_t SHOW_ADDRESS = 0x01;  // even without object code
+  static constexpr std::uint8_t CACHED       = 0x02;  // output can be replayed
+
+  // Word starts are only recorded for this many leading bytes of a
+  // line, more than a listing line shows.
+  static constexpr std::size_t WORD_START_BYTES = 32;
+
+  static std::shared_ptr<LineTable> create(std::size_t line_count);
+
+  LineTable           (const LineTable& ) = delete;  // no copy constructor
+  LineTable           (      LineTable& ) = delete;  // no move constructor
+  LineTable& operator=(const LineTable& ) = delete;  // no copy assignment
+  LineTable& operator=(      LineTable&&) = delete;  // no move assignment
+
+  std::size_t size() const;
+
+  // Makes the pool of the pass just finished the previous pool, and
+  // starts an empty one.
+  void start_pass();
+
+  // the pool of the current pass, to which object code is appended
+  std::vector<std::uint8_t>& get_pool();
+
+  // Records the output of a line, whose object code is at offset in
+  // the current pool.
+  void record(std::size_t index,
+	      std::uint16_t address,
+	      std::uint32_t offset,
+	      std::uint32_t length,
+	      std::uint32_t word_starts,
+	      std::uint8_t flags,
+	      Listing::Control listing_control);
+
+  // Adds base to the offsets of a range of lines, whose object code was
+  // assembled in a pool of their own, and then appended to the current
+  // pool at base.
+  void rebase(std::size_t begin,
+	      std::size_t end,
+	      std::uint32_t base);
+
+  std::uint16_t get_address(std::size_t index) const;
+  std::uint32_t get_length(std::size_t index) const;
+  std::uint32_t get_word_starts(std::size_t index) const;  // bit i set if a word starts at byte i
+  std::uint8_t get_flags(std::size_t index) const;
+  Listing::Control get_listing_control(std::size_t index) const;
+
+  // object code of a line recorded by the current pass
+  std::span<const std::uint8_t> get_object_code(std::size_t index) const;
+  std::span<std::uint8_t> get_object_code(std::size_t index);
+
+  // object code of a line recorded by the previous pass, and not yet
+  // recorded by the current pass
+  std::span<const std::uint8_t> get_previous_object_code(std::size_t index) const;
+
+protected:
+  LineTable(std::size_t line_count);
+
+  std::vector<std::uint16_t> m_addresses;
+  std::vector<std::uint32_t> m_offsets;
+  std::vector<std::uint32_t> m_lengths;
+  std::vector<std::uint32_t> m_word_starts;
+  std::vector<std::uint8_t> m_flags;
+  std::vector<Listing::Control> m_listing_controls;
+
+  std::vector<std::uint8_t> m_pool;
+  std::vector<std::uint8_t> m_previous_pool;
+};
+
+#endif // LINE_TABLE_HH
@@ -0,0 +1,220 @@
+// listing.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <algorithm>
+#include <charconv>
+#include <format>
+
+#include "listing.hh"
+#include "utility.hh"
+
+static constexpr utility::HexDigitTable s_hex_digits = utility::make_hex_digit_table(false);
+
+// Append s to result, expanding tabs to every eighth column.
+static void append_untabified(std::string& result, std::string_view s)
+{
+  std::size_t line_start = result.size();
+  while (true)
+  {
+    std::size_t tab = s.find('\t');
+    result.append(s.substr(0, tab));
+    if (tab == std::string_view::npos)
+    {
+      return;
+    }
+    std::size_t col = result.size() - line_start;
+    result.append(8 - (col & 7), ' ');
+    s.remove_prefix(tab + 1);
+  }
+}
+
+std::shared_ptr<Listing> Listing::create(std::ostream& os,
+					 std::string_view title)
+{
+  auto p = new Listing(os, title);
+  return std::shared_ptr<Listing>(p);
+}
+
+Listing::Listing(std::ostream& os,
+		 std::string_view title):
+  m_os(os),
+  m_title(title),
+  m_page_length(DEFAULT_PAGE_LENGTH)
+{
+  m_buffer.reserve(BUFFER_SIZE);
+  start();
+}
+
+void Listing::set_page_length(unsigned page_length)
+{
+  // leave room for at least one line under the header
+  m_page_length = page_length ? std::max(page_length, HEADER_LINES + 1) : 0;
+}
+
+void Listing::start()
+{
+  m_enabled = true;
+  m_page_number = 0;
+  m_lines_on_page = 0;
+}
+
+Listing::Line Listing::make_line(unsigned source_line_number,
+				std::string_view text,
+				Control control,
+				std::optional<std::uint16_t> address,
+				std::span<const std::uint8_t> object_code_bytes,
+				std::uint32_t word_starts)
+{
+  Line line { .source_line_number = source_line_number,
+	      .text               = text,
+	      .control            = control,
+	      .show_address       = address.has_value(),
+	      .address            = address.value_or(0),
+	      .byte_count         = std::uint8_t(std::min(object_code_bytes.size(), MAX_OBJECT_BYTES_PER_LINE)),
+	      .start_of_word      = std::uint8_t(word_starts & ((1 << MAX_OBJECT_BYTES_PER_LINE) - 1)),
+	      .bytes              = {} };
+  std::copy_n(object_code_bytes.begin(), line.byte_count, line.bytes.begin());
+  return line;
+}
+
+void Listing::list_line(const Line& line)
+{
+  switch (line.control)
+  {
+  case Control::LIST:
+    m_enabled = true;
+    break;
+  case Control::PAGE:
+    if (m_enabled)
+    {
+      new_page();
+    }
+    return;
+  default:
+    break;
+  }
+
+  if (m_enabled)
+  {
+    append_line(line);
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+      flush();
+    }
+  }
+
+  if (line.control == Control::NOLIST)
+  {
+    m_enabled = false;
+  }
+}
+
+void Listing::list_text(std::string_view text)
+{
+  start_line();
+  m_buffer += text;
+  m_buffer += '\n';
+  ++m_lines_on_page;
+  if (m_buffer.size() >= BUFFER_SIZE)
+  {
+    flush();
+  }
+}
+
+void Listing::flush()
+{
+  m_os.write(m_buffer.data(), m_buffer.size());
+  m_buffer.clear();
+}
+
+// The header of the next page is written before the next line listed,
+// so that consecutive page breaks don't produce empty pages.
+void Listing::new_page()
+{
+  if (m_page_length && (m_lines_on_page > HEADER_LINES))
+  {
+    m_lines_on_page = m_page_length;
+  }
+}
+
+void Listing::append_header()
+{
+  if (m_page_number)
+  {
+    m_buffer += '\f';
+  }
+  ++m_page_number;
+  m_buffer += std::format("impala 6502 assembler    {:<40}  page {:>4}\n\n", m_title, m_page_number);
+  m_lines_on_page = HEADER_LINES;
+}
+
+// Writes a page header first if the line starts a page.
+void Listing::start_line()
+{
+  if (m_page_length && ((! m_page_number) || (m_lines_on_page >= m_page_length)))
+  {
+    append_header();
+  }
+}
+
+void Listing::append_line(const Line& line)
+{
+  start_line();
+
+  // line number, right justified in five columns
+  char number[16];
+  char* number_end = std::to_chars(number, number + sizeof(number), line.source_line_number).ptr;
+  std::size_t number_length = number_end - number;
+  if (number_length < 5)
+  {
+    m_buffer.append(5 - number_length, ' ');
+  }
+  m_buffer.append(number, number_length);
+  m_buffer += "  ";
+
+  if (line.show_address)
+  {
+    utility::append_hex(m_buffer, s_hex_digits, line.address);
+    m_buffer += ' ';
+  }
+  else
+  {
+    m_buffer += "     ";
+  }
+
+  // Object code bytes, or words. A word that would go past the bytes
+  // kept for the line isn't shown, so the field never overflows its
+  // width.
+  static constexpr std::size_t OBJECT_FIELD_WIDTH = 3 * MAX_OBJECT_BYTES_PER_LINE;
+  std::size_t field_start = m_buffer.size();
+  std::size_t i = 0;
+  while (i < line.byte_count)
+  {
+    if (line.start_of_word & (1 << i))
+    {
+      if (i + 2 > line.byte_count)
+      {
+	break;
+      }
+      m_buffer += ' ';
+      utility::append_hex(m_buffer,
+			  s_hex_digits,
+			  std::uint16_t((line.bytes[i+1] << 8) | line.bytes[i]));
+      i += 2;
+    }
+    else
+    {
+      m_buffer += ' ';
+      utility::append_hex(m_buffer, s_hex_digits, line.bytes[i]);
+      ++i;
+    }
+  }
+  m_buffer.append(OBJECT_FIELD_WIDTH - (m_buffer.size() - field_start), ' ');
+
+  m_buffer += "  ";
+  append_untabified(m_buffer, line.text);
+  m_buffer += '\n';
+  ++m_lines_on_page;
+}
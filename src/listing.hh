@@ -0,0 +1,109 @@
+// listing.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef LISTING_HH
+#define LISTING_HH
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Formats listing lines into a buffer, which is written out in large
+// blocks. While listing is disabled by .NOLIST, lines are dropped
+// without being formatted.
+class Listing
+{
+public:
+  // effect of a source line on the listing, other than listing it
+  enum class Control
+  {
+    NONE,
+    LIST,    // enable listing; the line is listed
+    NOLIST,  // disable listing; the line is listed
+    PAGE,    // start a new page; the line isn't listed
+  };
+
+  static constexpr unsigned DEFAULT_PAGE_LENGTH = 60;
+  static constexpr std::size_t MAX_OBJECT_BYTES_PER_LINE = 3;
+
+  // Everything needed to list a source line, by value, so that it can
+  // be handed to another thread.
+  struct Line
+  {
+    unsigned source_line_number;
+    std::string_view text;           // must outlive the listing
+    Control control;
+    bool show_address;
+    std::uint16_t address;
+    std::uint8_t byte_count;         // of the bytes shown
+    std::uint8_t start_of_word;      // bit i set if a word starts at bytes[i]
+    std::array<std::uint8_t, MAX_OBJECT_BYTES_PER_LINE> bytes;
+  };
+
+  // Only the object code bytes that fit on the line are kept.
+  static Line make_line(unsigned source_line_number,
+			std::string_view text,
+			Control control,
+			std::optional<std::uint16_t> address,
+			std::span<const std::uint8_t> object_code_bytes,
+			std::uint32_t word_starts);  // bit i set if a word starts at byte i
+
+  static std::shared_ptr<Listing> create(std::ostream& os,
+					 std::string_view title);
+
+  Listing           (const Listing& ) = delete;  // no copy constructor
+  Listing           (      Listing& ) = delete;  // no move constructor
+  Listing& operator=(const Listing& ) = delete;  // no copy assignment
+  Listing& operator=(      Listing&&) = delete;  // no move assignment
+
+  // Lines per page, including the page header. Zero disables
+  // pagination, in which case there are no page headers, and .PAGE is
+  // ignored.
+  void set_page_length(unsigned page_length);
+
+  // Resets the list state and pagination, for a new listing.
+  void start();
+
+  // Lists a source line, subject to the list state, after applying
+  // its control.
+  void list_line(const Line& line);
+
+  // Starts a new page, if paginated.
+  void new_page();
+
+  // Lists a line of text other than a source line, such as the symbol
+  // table. It isn't subject to the list state.
+  void list_text(std::string_view text);
+
+  // Writes out whatever is buffered.
+  void flush();
+
+protected:
+  Listing(std::ostream& os,
+	  std::string_view title);
+
+  static constexpr unsigned HEADER_LINES = 2;  // title line and a blank line
+  static constexpr std::size_t BUFFER_SIZE = 1 << 20;
+
+  void start_line();
+  void append_header();
+  void append_line(const Line& line);
+
+  std::ostream& m_os;
+  std::string m_title;
+  std::string m_buffer;
+
+  unsigned m_page_length;
+  bool m_enabled;
+  unsigned m_page_number;    // zero before the first page is started
+  unsigned m_lines_on_page;  // including the header
+};
+
+#endif // LISTING_HH
@@ -0,0 +1,53 @@
+// listing_writer.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "listing_writer.hh"
+
+std::shared_ptr<ListingWriter> ListingWriter::create(std::shared_ptr<Listing> listing_sp)
+{
+  auto p = new ListingWriter(listing_sp);
+  return std::shared_ptr<ListingWriter>(p);
+}
+
+ListingWriter::ListingWriter(std::shared_ptr<Listing> listing_sp):
+  m_listing_sp(listing_sp),
+  m_ring(RING_CAPACITY)
+{
+  m_thread = std::thread(& ListingWriter::run, this);
+}
+
+ListingWriter::~ListingWriter()
+{
+  finish();
+}
+
+bool ListingWriter::try_list_line(const Listing::Line& line)
+{
+  return m_ring.try_push(line);
+}
+
+void ListingWriter::list_line(const Listing::Line& line)
+{
+  m_ring.push(line);
+}
+
+void ListingWriter::finish()
+{
+  if (m_thread.joinable())
+  {
+    m_ring.close();
+    m_thread.join();
+  }
+}
+
+void ListingWriter::run()
+{
+  Listing::Line line;
+  while (m_ring.pop(line))
+  {
+    m_listing_sp->list_line(line);
+  }
+  m_listing_sp->flush();
+}
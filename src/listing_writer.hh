@@ -0,0 +1,46 @@
+// listing_writer.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef LISTING_WRITER_HH
+#define LISTING_WRITER_HH
+
+#include <memory>
+#include <thread>
+
+#include "listing.hh"
+#include "spsc_ring.hh"
+
+// Formats and writes a listing on a thread of its own. Lines are
+// queued by one producer thread, in order, through a bounded ring.
+class ListingWriter
+{
+public:
+  static std::shared_ptr<ListingWriter> create(std::shared_ptr<Listing> listing_sp);
+  ~ListingWriter();
+
+  ListingWriter           (const ListingWriter& ) = delete;  // no copy constructor
+  ListingWriter           (      ListingWriter& ) = delete;  // no move constructor
+  ListingWriter& operator=(const ListingWriter& ) = delete;  // no copy assignment
+  ListingWriter& operator=(      ListingWriter&&) = delete;  // no move assignment
+
+  bool try_list_line(const Listing::Line& line);  // false if the ring is full
+  void list_line(const Listing::Line& line);      // waits for space
+
+  // Waits for the queued lines to be listed, and flushes the listing.
+  void finish();
+
+protected:
+  ListingWriter(std::shared_ptr<Listing> listing_sp);
+
+  static constexpr std::size_t RING_CAPACITY = 4096;  // lines
+
+  void run();
+
+  std::shared_ptr<Listing> m_listing_sp;
+  SpscRing<Listing::Line> m_ring;
+  std::thread m_thread;
+};
+
+#endif // LISTING_WRITER_HH
@@ -3,19 +3,43 @@
 // Copyright 2022-2025 Eric Smith
 // SPDX-License-Identifier: GPL-3.0-only
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <cstdlib>
+#include <filesystem>
 #include <format>
+#include <fstream>
 #include <initializer_list>
 #include <iostream>
+#include <optional>
+#include <set>
 #include <string>
+#include <system_error>
+#include <vector>
 
 #include <boost/program_options.hpp>
+#include <magic_enum.hpp>
 
 #include "assembler.hh"
+#include "diagnostic.hh"
+#include "instruction_set.hh"
+#include "listing.hh"
+#include "object_format.hh"
+#include "pseudo_op.hh"
+#include "thread_pool.hh"
 
 
 namespace po = boost::program_options;
 
+// true if the option was given, rather than just having a default
+// value, as switches always do
+static bool option_given(const boost::program_options::variables_map& vm,
+			 const std::string& opt)
+{
+  return vm.count(opt) && ! vm[opt].defaulted();
+}
+
 void conflicting_options(const boost::program_options::variables_map& vm,
 			 std::initializer_list<const std::string> opts)
 {
@@ -25,11 +49,11 @@ void conflicting_options(const boost::program_options::variables_map& vm,
   }
   for (auto opt1 = opts.begin(); opt1 < opts.end(); opt1++)
   {
-    if (vm.count(*opt1))
+    if (option_given(vm, *opt1))
     {
       for (auto opt2 = opt1 + 1; opt2 != opts.end(); opt2++)
       {
-	if (vm.count(*opt2))
+	if (option_given(vm, *opt2))
 	{
 	  std::cerr << std::format("Options {} and {} are mutually exclusive\n", *opt1, *opt2);
 	  std::exit(1);
@@ -41,21 +65,293 @@ void conflicting_options(const boost::program_options::variables_map& vm,
 
 
 constexpr std::string source_fn_suffix = ".p65";
-constexpr std::string binary_fn_suffix = ".bin";
 constexpr std::string listing_fn_suffix = ".lst";
 
+struct OutputOptions
+{
+  bool check_only = false;  // no output files at all
+  bool listing = true;
+  std::vector<ObjectFormat> object_formats;  // empty for none
+  std::uint8_t fill_byte = 0xff;
+  unsigned page_length = Listing::DEFAULT_PAGE_LENGTH;
+  bool writer_thread = false;
+};
+
+struct SourceResult
+{
+  bool failed = false;        // assembly stopped by an exception
+  std::size_t byte_count = 0;
+  std::chrono::duration<double> elapsed {};
+};
+
+static void print_pass_statistics(const Assembler& assembler)
+{
+  for (const auto& pass: assembler.get_pass_statistics())
+  {
+    std::string_view kind = (! pass.final_pass) ? "sizing" : (pass.pass_number == 1) ? "single" : "final";
+    std::cout << std::format("pass {} ({}): {} lines ({} replayed, {} fixed size), {} bytes, {} symbols defined or moved, {} forward references, {} errors, {} warnings, {:.3f} s\n",
+			     pass.pass_number,
+			     kind,
+			     pass.line_count,
+			     pass.replayed_line_count,
+			     pass.fixed_size_line_count,
+			     pass.byte_count,
+			     pass.symbols_changed,
+			     pass.forward_references,
+			     pass.error_count,
+			     pass.warning_count,
+			     pass.elapsed.count());
+    if (pass.chunk_count > 1)
+    {
+      std::cout << std::format("pass {}: assembled in {} chunks\n", pass.pass_number, pass.chunk_count);
+    }
+    if (pass.fixup_count)
+    {
+      std::cout << std::format("pass {}: applied {} fixups\n", pass.pass_number, pass.fixup_count);
+    }
+  }
+}
+
+static void report_failure(DiagnosticSink& diagnostics,
+			   const std::string& source_fn,
+			   const std::exception& e)
+{
+  Diagnostic diagnostic { .severity = Severity::FATAL,
+			  .file     = source_fn,
+			  .line     = 0,
+			  .column   = 0,
+			  .message  = e.what() };
+  if (auto assembler_error = dynamic_cast<const AssemblerError*>(&e))
+  {
+    diagnostic.line = assembler_error->get_source_line_number();
+    diagnostic.message = assembler_error->get_message();
+  }
+  diagnostics.report(diagnostic);
+}
+
+static SourceResult assemble_source(std::shared_ptr<InstructionSet> instruction_set_sp,
+				    std::shared_ptr<PseudoOp> pseudo_op_sp,
+				    const std::string& source_fn,
+				    std::shared_ptr<DiagnosticSink> diagnostics_sp,
+				    const OutputOptions& output_options,
+				    bool single_pass,
+				    unsigned jobs,
+				    bool print_statistics)
+{
+  SourceResult result;
+  auto start_time = std::chrono::steady_clock::now();
+
+  std::string base_fn = source_fn;
+  if (source_fn.ends_with(source_fn_suffix))
+  {
+    base_fn = source_fn.substr(0, source_fn.size() - source_fn_suffix.size());
+  }
+
+  try
+  {
+    Assembler assembler(instruction_set_sp,
+			pseudo_op_sp,
+			source_fn);
+
+    if (output_options.listing)
+    {
+      assembler.set_listing_file(base_fn + listing_fn_suffix);
+      assembler.set_listing_page_length(output_options.page_length);
+      assembler.set_writer_thread(output_options.writer_thread);
+    }
+    for (ObjectFormat format: output_options.object_formats)
+    {
+      assembler.add_object_file(format, base_fn + get_object_format_info(format).suffix);
+    }
+    assembler.set_fill_byte(output_options.fill_byte);
+    assembler.set_check_only(output_options.check_only);
+    assembler.set_diagnostic_sink(diagnostics_sp);
+    assembler.set_single_pass(single_pass);
+    assembler.set_jobs(jobs);
+    try
+    {
+      assembler.assemble();
+    }
+    catch (const std::exception& e)
+    {
+      result.failed = true;
+      report_failure(*diagnostics_sp, source_fn, e);
+    }
+    if (print_statistics)
+    {
+      print_pass_statistics(assembler);
+    }
+    const auto& passes = assembler.get_pass_statistics();
+    if (! passes.empty())
+    {
+      result.byte_count = passes.back().byte_count;
+    }
+  }
+  catch (const std::exception& e)
+  {
+    result.failed = true;
+    report_failure(*diagnostics_sp, source_fn, e);
+  }
+
+  result.elapsed = std::chrono::steady_clock::now() - start_time;
+  return result;
+}
+
+// A manifest lists one source file per line. Blank lines and lines
+// starting with '#' are ignored, and relative paths are relative to
+// the directory containing the manifest.
+static std::vector<std::string> read_manifest(const std::string& manifest_fn)
+{
+  std::ifstream manifest(manifest_fn);
+  if (! manifest.is_open())
+  {
+    std::cerr << std::format("can't open manifest {}\n", manifest_fn);
+    std::exit(1);
+  }
+  std::filesystem::path manifest_dir = std::filesystem::path(manifest_fn).parent_path();
+  std::vector<std::string> source_fns;
+  std::string line;
+  while (std::getline(manifest, line))
+  {
+    std::size_t first = line.find_first_not_of(" \t\r");
+    if ((first == std::string::npos) || (line[first] == '#'))
+    {
+      continue;
+    }
+    std::size_t last = line.find_last_not_of(" \t\r");
+    std::filesystem::path source_path(line.substr(first, last + 1 - first));
+    if (source_path.is_relative())
+    {
+      source_path = manifest_dir / source_path;
+    }
+    source_fns.push_back(source_path.string());
+  }
+  return source_fns;
+}
+
+// A source file given more than once, whether on the command line or
+// in the manifest, and by whatever path, would be assembled
+// concurrently into the same output files, so only the first is kept.
+static void remove_repeated_sources(std::vector<std::string>& source_fns)
+{
+  std::set<std::filesystem::path> seen;
+  std::vector<std::string> unique_source_fns;
+  for (const std::string& source_fn: source_fns)
+  {
+    std::error_code error;
+    std::filesystem::path path = std::filesystem::weakly_canonical(source_fn, error);
+    if (error)
+    {
+      path = std::filesystem::absolute(source_fn).lexically_normal();
+    }
+    if (! seen.insert(path).second)
+    {
+      std::cerr << std::format("ignoring repeated source file {}\n", source_fn);
+      continue;
+    }
+    unique_source_fns.push_back(source_fn);
+  }
+  source_fns = std::move(unique_source_fns);
+}
+
+// Formats may be given as separate options, or separated by commas.
+static std::vector<ObjectFormat> parse_object_formats(const std::vector<std::string>& format_args)
+{
+  std::vector<ObjectFormat> formats;
+  for (const std::string& arg: format_args)
+  {
+    std::string_view names = arg;
+    while (true)
+    {
+      std::size_t comma = names.find(',');
+      std::string_view name = names.substr(0, comma);
+      auto format = find_object_format(name);
+      if (! format)
+      {
+	std::cerr << std::format("unknown object format \"{}\"\n", name);
+	std::exit(1);
+      }
+      if (std::find(formats.begin(), formats.end(), *format) == formats.end())
+      {
+	formats.push_back(*format);
+      }
+      if (comma == std::string_view::npos)
+      {
+	break;
+      }
+      names.remove_prefix(comma + 1);
+    }
+  }
+  return formats;
+}
+
+// The fill byte may be decimal, or hexadecimal with a "$" or "0x"
+// prefix.
+static std::uint8_t parse_fill_byte(const std::string& arg)
+{
+  std::string_view digits = arg;
+  int base = 10;
+  if (digits.starts_with('$'))
+  {
+    digits.remove_prefix(1);
+    base = 16;
+  }
+  else if (digits.starts_with("0x") || digits.starts_with("0X"))
+  {
+    digits.remove_prefix(2);
+    base = 16;
+  }
+  unsigned value = 0;
+  auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), value, base);
+  if (digits.empty() || (ec != std::errc()) || (end != digits.data() + digits.size()) || (value > 0xff))
+  {
+    std::cerr << std::format("invalid fill byte \"{}\"\n", arg);
+    std::exit(1);
+  }
+  return value;
+}
+
+static std::string object_format_help()
+{
+  std::string s = "object file format, may be repeated or comma separated:";
+  for (ObjectFormat format: magic_enum::enum_values<ObjectFormat>())
+  {
+    const ObjectFormatInfo& info = get_object_format_info(format);
+    s += std::format("\n{} ({}, {})", info.name, info.description, info.suffix);
+  }
+  return s;
+}
+
 int main(int argc, char *argv[])
 {
-  std::string source_fn;
+  std::vector<std::string> source_fns;
+  std::string manifest_fn;
+  std::vector<std::string> format_args;
+  std::string fill_arg;
+  OutputOptions output_options;
+  bool no_listing = false;
+  bool no_object = false;
+  bool single_pass = false;
+  std::optional<unsigned> jobs;  // by default, 1 for a single file, otherwise 0
   try
   {
     po::options_description gen_opts("Options");
     gen_opts.add_options()
-      ("help", "output help message");
+      ("help", "output help message")
+      ("single-pass", po::bool_switch(&single_pass), "assemble in a single pass, patching forward references at the end of the source")
+      ("jobs,j", po::value<unsigned>(), "number of threads (0 for one per hardware thread); with one source file, used for parsing and the final pass (default 1), otherwise to assemble files concurrently (default one per hardware thread)")
+      ("manifest", po::value<std::string>(&manifest_fn), "file listing source files, one per line")
+      ("format,f", po::value<std::vector<std::string>>(&format_args)->composing(), object_format_help().c_str())
+      ("fill", po::value<std::string>(&fill_arg)->default_value("$ff"), "fill byte for gaps in binary object formats")
+      ("page-length", po::value<unsigned>(&output_options.page_length)->default_value(Listing::DEFAULT_PAGE_LENGTH), "listing lines per page, including the page header (0 for no pagination)")
+      ("no-listing", po::bool_switch(&no_listing), "don't write a listing file")
+      ("writer-thread", po::bool_switch(&output_options.writer_thread), "format and write the listing on a separate thread during the final pass")
+      ("no-object", po::bool_switch(&no_object), "don't write any object file")
+      ("check", po::bool_switch(&output_options.check_only), "only check the source for errors, writing no files");
 
     po::options_description hidden_opts("Hidden options:");
     hidden_opts.add_options()
-      ("source", po::value<std::string>(&source_fn), "source filename");
+      ("source", po::value<std::vector<std::string>>(&source_fns), "source filename");
 
     po::positional_options_description positional_opts;
     positional_opts.add("source", -1);
@@ -68,17 +364,19 @@ int main(int argc, char *argv[])
 	      options(cmdline_opts).positional(positional_opts).run(), vm);
     po::notify(vm);
 
-    if (vm.count("help"))
+    if (vm.count("jobs"))
     {
-      std::cout << "Usage: " << argv[0] << " [options]\n\n";
-      std::cout << gen_opts << "\n";
-      return 0;
+      jobs = vm["jobs"].as<unsigned>();
     }
 
-    if (vm.count("source") != 1)
+    conflicting_options(vm, { "no-object", "format" });
+    conflicting_options(vm, { "check", "format" });
+
+    if (vm.count("help"))
     {
-      std::cout << "source file must be specified\n";
-      std::exit(1);
+      std::cout << "Usage: " << argv[0] << " [options] source...\n\n";
+      std::cout << gen_opts << "\n";
+      return 0;
     }
   }
   catch (po::error& e)
@@ -87,18 +385,83 @@ int main(int argc, char *argv[])
     std::exit(1);
   }
 
-  std::string base_fn = source_fn;
-  if (source_fn.ends_with(source_fn_suffix))
+  if (! manifest_fn.empty())
   {
-    base_fn = source_fn.substr(0, source_fn.size() - source_fn_suffix.size());
+    std::vector<std::string> manifest_source_fns = read_manifest(manifest_fn);
+    source_fns.insert(source_fns.end(), manifest_source_fns.begin(), manifest_source_fns.end());
   }
+  remove_repeated_sources(source_fns);
+  if (source_fns.empty())
+  {
+    std::cout << "source file must be specified\n";
+    std::exit(1);
+  }
+
+  output_options.object_formats = parse_object_formats(format_args);
+  if (output_options.object_formats.empty() && ! (no_object || output_options.check_only))
+  {
+    output_options.object_formats.push_back(ObjectFormat::ASM65);
+  }
+  output_options.fill_byte = parse_fill_byte(fill_arg);
+  output_options.listing = ! (no_listing || output_options.check_only);
 
-  std::string binary_fn  = base_fn + binary_fn_suffix;
-  std::string listing_fn = base_fn + listing_fn_suffix;
+  // The tables are built at compile time, but are still shared rather
+  // than created for each source file.
+  auto instruction_set_sp = InstructionSet::create();
+  auto pseudo_op_sp = PseudoOp::create();
 
-  Assembler assembler(source_fn,
-		      binary_fn,
-		      listing_fn);
+  if ((source_fns.size() == 1) && manifest_fn.empty())
+  {
+    auto diagnostics_sp = BufferedDiagnosticSink::create();
+    SourceResult result = assemble_source(instruction_set_sp, pseudo_op_sp, source_fns[0], diagnostics_sp, output_options, single_pass, jobs.value_or(1), true);
+    diagnostics_sp->write(std::cerr);
+    return (result.failed || diagnostics_sp->get_count(Severity::ERROR)) ? 1 : 0;
+  }
 
-  assembler.assemble();
+  // Batch mode: each source file is assembled serially, but the files
+  // are assembled concurrently, by default on every hardware thread.
+  auto start_time = std::chrono::steady_clock::now();
+  std::vector<SourceResult> results(source_fns.size());
+  auto diagnostic_collector_sp = DiagnosticCollector::create(source_fns.size());
+  auto thread_pool_sp = ThreadPool::create(jobs.value_or(0));
+  for (std::size_t i = 0; i < source_fns.size(); i++)
+  {
+    thread_pool_sp->submit([&, i] ()
+    {
+      results[i] = assemble_source(instruction_set_sp,
+				   pseudo_op_sp,
+				   source_fns[i],
+				   diagnostic_collector_sp->get_sink(i),
+				   output_options,
+				   single_pass,
+				   1,
+				   false);
+    });
+  }
+  thread_pool_sp->wait();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+
+  diagnostic_collector_sp->flush(std::cerr);
+
+  std::size_t failed_count = 0;
+  std::size_t byte_count = 0;
+  std::chrono::duration<double> total_time {};
+  for (const SourceResult& result: results)
+  {
+    failed_count += result.failed;
+    byte_count += result.byte_count;
+    total_time += result.elapsed;
+  }
+  unsigned error_count = diagnostic_collector_sp->get_count(Severity::ERROR);
+  std::cout << std::format("{} files, {} failed, {} errors, {} warnings, {} bytes\n",
+			   source_fns.size(),
+			   failed_count,
+			   error_count,
+			   diagnostic_collector_sp->get_count(Severity::WARNING),
+			   byte_count);
+  std::cout << std::format("{:.3f} s elapsed on {} threads, {:.3f} s total assembly time\n",
+			   elapsed.count(),
+			   thread_pool_sp->get_thread_count(),
+			   total_time.count());
+  return (failed_count || error_count) ? 1 : 0;
 }
@@ -0,0 +1,147 @@
+// memory_image.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <algorithm>
+#include <bit>
+
+#include "memory_image.hh"
+
+std::shared_ptr<MemoryImage> MemoryImage::create()
+{
+  auto p = new MemoryImage();
+  return std::shared_ptr<MemoryImage>(p);
+}
+
+MemoryImage::MemoryImage()
+{
+  clear();
+}
+
+void MemoryImage::clear()
+{
+  m_bytes.fill(0);
+  m_written.fill(0);
+  m_source_line_numbers.fill(0);
+}
+
+// the bits of the given bitmap word that are in [begin, end)
+std::uint64_t MemoryImage::word_mask(std::uint32_t word,
+				     std::uint32_t begin,
+				     std::uint32_t end)
+{
+  std::uint32_t word_begin = word * BITS_PER_WORD;
+  std::uint32_t first = std::max(begin, word_begin) - word_begin;
+  std::uint32_t last = std::min(end, word_begin + BITS_PER_WORD) - word_begin;  // exclusive
+  std::uint64_t mask = ~std::uint64_t(0) << first;
+  if (last < BITS_PER_WORD)
+  {
+    mask &= ~(~std::uint64_t(0) << last);
+  }
+  return mask;
+}
+
+std::optional<MemoryImage::Overlap> MemoryImage::write(std::uint16_t address,
+						       std::span<const std::uint8_t> bytes,
+						       unsigned source_line_number)
+{
+  std::size_t first_count = std::min<std::size_t>(bytes.size(), SIZE - address);
+  std::optional<Overlap> overlap = write_range(address, bytes.first(first_count), source_line_number);
+  if (first_count < bytes.size())
+  {
+    std::optional<Overlap> wrapped_overlap = write_range(0, bytes.subspan(first_count), source_line_number);
+    if (! overlap)
+    {
+      overlap = wrapped_overlap;
+    }
+  }
+  return overlap;
+}
+
+std::optional<MemoryImage::Overlap> MemoryImage::write_range(std::uint32_t begin,
+							     std::span<const std::uint8_t> bytes,
+							     unsigned source_line_number)
+{
+  if (bytes.empty())
+  {
+    return std::nullopt;
+  }
+  std::uint32_t end = begin + bytes.size();
+  std::optional<Overlap> overlap;
+  for (std::uint32_t word = begin / BITS_PER_WORD; word <= (end - 1) / BITS_PER_WORD; word++)
+  {
+    std::uint64_t mask = word_mask(word, begin, end);
+    std::uint64_t already_written = m_written[word] & mask;
+    if (already_written && ! overlap)
+    {
+      std::uint16_t address = word * BITS_PER_WORD + std::countr_zero(already_written);
+      overlap = Overlap { address, m_source_line_numbers[address] };
+    }
+    m_written[word] |= mask;
+  }
+  std::copy(bytes.begin(), bytes.end(), m_bytes.begin() + begin);
+  std::fill(m_source_line_numbers.begin() + begin, m_source_line_numbers.begin() + end, source_line_number);
+  return overlap;
+}
+
+bool MemoryImage::is_written(std::uint16_t address) const
+{
+  return (m_written[address / BITS_PER_WORD] >> (address % BITS_PER_WORD)) & 1;
+}
+
+std::uint8_t MemoryImage::get(std::uint16_t address) const
+{
+  return m_bytes[address];
+}
+
+unsigned MemoryImage::get_source_line_number(std::uint16_t address) const
+{
+  return m_source_line_numbers[address];
+}
+
+std::span<const std::uint8_t, MemoryImage::SIZE> MemoryImage::get_bytes() const
+{
+  return m_bytes;
+}
+
+bool MemoryImage::empty() const
+{
+  return std::all_of(m_written.begin(), m_written.end(), [] (std::uint64_t word) { return word == 0; });
+}
+
+// Whole words of the bitmap are skipped while looking for the start or
+// end of a run.
+std::vector<MemoryImage::Range> MemoryImage::get_written_ranges() const
+{
+  std::vector<Range> ranges;
+  std::uint32_t address = 0;
+  while (address < SIZE)
+  {
+    // find the next written byte
+    std::uint32_t word = address / BITS_PER_WORD;
+    std::uint64_t bits = m_written[word] & (~std::uint64_t(0) << (address % BITS_PER_WORD));
+    while ((! bits) && (++word < m_written.size()))
+    {
+      bits = m_written[word];
+    }
+    if (! bits)
+    {
+      break;
+    }
+    std::uint32_t begin = word * BITS_PER_WORD + std::countr_zero(bits);
+
+    // find the next unwritten byte
+    word = begin / BITS_PER_WORD;
+    bits = ~m_written[word] & (~std::uint64_t(0) << (begin % BITS_PER_WORD));
+    while ((! bits) && (++word < m_written.size()))
+    {
+      bits = ~m_written[word];
+    }
+    std::uint32_t end = bits ? (word * BITS_PER_WORD + std::countr_zero(bits)) : SIZE;
+
+    ranges.push_back(Range { begin, end });
+    address = end;
+  }
+  return ranges;
+}
@@ -0,0 +1,81 @@
+// memory_image.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef MEMORY_IMAGE_HH
+#define MEMORY_IMAGE_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+// The complete 64K address space of the assembled program. Each byte
+// has a written bit, kept in a bitmap of 64-bit words so that a range
+// can be tested for overlap a word at a time, and the number of the
+// source line that wrote it.
+class MemoryImage
+{
+public:
+  static constexpr std::uint32_t SIZE = 0x10000;
+
+  static std::shared_ptr<MemoryImage> create();
+
+  MemoryImage           (const MemoryImage& ) = delete;  // no copy constructor
+  MemoryImage           (      MemoryImage& ) = delete;  // no move constructor
+  MemoryImage& operator=(const MemoryImage& ) = delete;  // no copy assignment
+  MemoryImage& operator=(      MemoryImage&&) = delete;  // no move assignment
+
+  void clear();
+
+  struct Overlap
+  {
+    std::uint16_t address;
+    unsigned source_line_number;  // of the earlier write
+  };
+
+  // Writes the bytes, wrapping from $FFFF to $0000. Bytes that were
+  // already written are overwritten; the first of them, if any, is
+  // returned.
+  std::optional<Overlap> write(std::uint16_t address,
+			       std::span<const std::uint8_t> bytes,
+			       unsigned source_line_number);
+
+  bool is_written(std::uint16_t address) const;
+  std::uint8_t get(std::uint16_t address) const;
+  unsigned get_source_line_number(std::uint16_t address) const;  // zero if not written
+
+  std::span<const std::uint8_t, SIZE> get_bytes() const;  // unwritten bytes are zero
+
+  bool empty() const;
+
+  // maximal runs of written bytes, in address order
+  struct Range
+  {
+    std::uint32_t begin;
+    std::uint32_t end;  // one past the last byte, so may be SIZE
+  };
+  std::vector<Range> get_written_ranges() const;
+
+protected:
+  MemoryImage();
+
+  std::optional<Overlap> write_range(std::uint32_t begin,
+				     std::span<const std::uint8_t> bytes,
+				     unsigned source_line_number);
+
+  static constexpr std::uint32_t BITS_PER_WORD = 64;
+  static std::uint64_t word_mask(std::uint32_t word,
+				 std::uint32_t begin,
+				 std::uint32_t end);
+
+  std::array<std::uint8_t, SIZE> m_bytes;
+  std::array<std::uint64_t, SIZE / BITS_PER_WORD> m_written;
+  std::array<std::uint32_t, SIZE> m_source_line_numbers;
+};
+
+#endif // MEMORY_IMAGE_HH
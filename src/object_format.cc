@@ -0,0 +1,225 @@
+// object_format.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <vector>
+
+#include <magic_enum.hpp>
+#include <magic_enum_containers.hpp>
+
+#include "object_format.hh"
+#include "utility.hh"
+
+// The ASM65 format keeps the ".bin" suffix that impala has always used
+// for it, so raw binary images get ".img".
+static const magic_enum::containers::array<ObjectFormat, ObjectFormatInfo> s_object_format_info
+{
+  ObjectFormatInfo { "asm65", ".bin", "ASM65 hex text" },
+  ObjectFormatInfo { "bin",   ".img", "raw binary image" },
+  ObjectFormatInfo { "ihex",  ".hex", "Intel HEX" },
+  ObjectFormatInfo { "srec",  ".s19", "Motorola S-record (S19)" },
+  ObjectFormatInfo { "prg",   ".prg", "binary image preceded by its load address" },
+};
+
+const ObjectFormatInfo& get_object_format_info(ObjectFormat format)
+{
+  return s_object_format_info[format];
+}
+
+std::optional<ObjectFormat> find_object_format(std::string_view name)
+{
+  for (ObjectFormat format: magic_enum::enum_values<ObjectFormat>())
+  {
+    if (name == s_object_format_info[format].name)
+    {
+      return format;
+    }
+  }
+  return std::nullopt;
+}
+
+static constexpr utility::HexDigitTable s_hex_digits = utility::make_hex_digit_table(true);
+
+static void append_hex(std::string& s, std::uint8_t byte)
+{
+  utility::append_hex(s, s_hex_digits, byte);
+}
+
+static void append_hex(std::string& s, std::span<const std::uint8_t> bytes)
+{
+  std::size_t pos = s.size();
+  s.resize(pos + 2 * bytes.size());
+  char* p = s.data() + pos;
+  for (std::uint8_t byte: bytes)
+  {
+    *p++ = s_hex_digits[byte][0];
+    *p++ = s_hex_digits[byte][1];
+  }
+}
+
+static std::uint8_t byte_sum(std::span<const std::uint8_t> bytes)
+{
+  std::uint8_t sum = 0;
+  for (std::uint8_t byte: bytes)
+  {
+    sum += byte;
+  }
+  return sum;
+}
+
+// data records hold at most this many bytes, for both Intel HEX and
+// S-records
+static constexpr std::size_t BYTES_PER_RECORD = 16;
+
+// worst case length of a record with BYTES_PER_RECORD bytes, in either
+// format, including the newline
+static constexpr std::size_t MAX_RECORD_LENGTH = 2 * BYTES_PER_RECORD + 12;
+
+static void append_intel_hex_record(std::string& s,
+				    std::uint8_t type,
+				    std::uint16_t address,
+				    std::span<const std::uint8_t> data)
+{
+  std::array<std::uint8_t, 4> header
+  {
+    std::uint8_t(data.size()),
+    std::uint8_t(address >> 8),
+    std::uint8_t(address),
+    type,
+  };
+  std::uint8_t sum = byte_sum(header) + byte_sum(data);
+  s += ':';
+  append_hex(s, header);
+  append_hex(s, data);
+  append_hex(s, std::uint8_t(-sum));
+  s += '\n';
+}
+
+static void append_s_record(std::string& s,
+			    char type,
+			    std::uint16_t address,
+			    std::span<const std::uint8_t> data)
+{
+  std::array<std::uint8_t, 3> header
+  {
+    std::uint8_t(data.size() + 3),  // address, data and checksum
+    std::uint8_t(address >> 8),
+    std::uint8_t(address),
+  };
+  std::uint8_t sum = byte_sum(header) + byte_sum(data);
+  s += 'S';
+  s += type;
+  append_hex(s, header);
+  append_hex(s, data);
+  append_hex(s, std::uint8_t(~sum));
+  s += '\n';
+}
+
+static void render_asm65(std::string& s,
+			 std::span<const std::uint8_t> bytes,
+			 const std::vector<MemoryImage::Range>& ranges)
+{
+  for (const MemoryImage::Range& range: ranges)
+  {
+    s += '*';
+    utility::append_hex(s, s_hex_digits, std::uint16_t(range.begin));
+    append_hex(s, bytes.subspan(range.begin, range.end - range.begin));
+  }
+}
+
+static void render_binary(std::string& s,
+			  std::span<const std::uint8_t> bytes,
+			  const std::vector<MemoryImage::Range>& ranges,
+			  std::uint8_t fill_byte)
+{
+  std::uint32_t address = ranges.front().begin;
+  for (const MemoryImage::Range& range: ranges)
+  {
+    s.append(range.begin - address, char(fill_byte));
+    s.append(reinterpret_cast<const char*>(bytes.data() + range.begin), range.end - range.begin);
+    address = range.end;
+  }
+}
+
+static void render_intel_hex(std::string& s,
+			     std::span<const std::uint8_t> bytes,
+			     const std::vector<MemoryImage::Range>& ranges)
+{
+  for (const MemoryImage::Range& range: ranges)
+  {
+    for (std::uint32_t address = range.begin; address < range.end; address += BYTES_PER_RECORD)
+    {
+      std::size_t count = std::min<std::size_t>(BYTES_PER_RECORD, range.end - address);
+      append_intel_hex_record(s, 0x00, address, bytes.subspan(address, count));
+    }
+  }
+  append_intel_hex_record(s, 0x01, 0x0000, {});  // end of file
+}
+
+static void render_s_record(std::string& s,
+			    std::span<const std::uint8_t> bytes,
+			    const std::vector<MemoryImage::Range>& ranges)
+{
+  append_s_record(s, '0', 0x0000, {});  // header
+  for (const MemoryImage::Range& range: ranges)
+  {
+    for (std::uint32_t address = range.begin; address < range.end; address += BYTES_PER_RECORD)
+    {
+      std::size_t count = std::min<std::size_t>(BYTES_PER_RECORD, range.end - address);
+      append_s_record(s, '1', address, bytes.subspan(address, count));
+    }
+  }
+  append_s_record(s, '9', 0x0000, {});  // termination
+}
+
+void render_object(std::string& s,
+		   const MemoryImage& image,
+		   ObjectFormat format,
+		   std::uint8_t fill_byte)
+{
+  std::span<const std::uint8_t> bytes = image.get_bytes();
+  std::vector<MemoryImage::Range> ranges = image.get_written_ranges();
+
+  std::size_t byte_count = 0;
+  for (const MemoryImage::Range& range: ranges)
+  {
+    byte_count += range.end - range.begin;
+  }
+
+  switch (format)
+  {
+  case ObjectFormat::ASM65:
+    s.reserve(s.size() + 2 * byte_count + 5 * ranges.size());
+    render_asm65(s, bytes, ranges);
+    break;
+
+  case ObjectFormat::BINARY:
+  case ObjectFormat::PRG:
+    if (ranges.empty())
+    {
+      break;
+    }
+    s.reserve(s.size() + 2 + ranges.back().end - ranges.front().begin);
+    if (format == ObjectFormat::PRG)
+    {
+      s += char(ranges.front().begin);
+      s += char(ranges.front().begin >> 8);
+    }
+    render_binary(s, bytes, ranges, fill_byte);
+    break;
+
+  case ObjectFormat::INTEL_HEX:
+    s.reserve(s.size() + MAX_RECORD_LENGTH * (byte_count / BYTES_PER_RECORD + ranges.size() + 1));
+    render_intel_hex(s, bytes, ranges);
+    break;
+
+  case ObjectFormat::S_RECORD:
+    s.reserve(s.size() + MAX_RECORD_LENGTH * (byte_count / BYTES_PER_RECORD + ranges.size() + 2));
+    render_s_record(s, bytes, ranges);
+    break;
+  }
+}
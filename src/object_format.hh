@@ -0,0 +1,44 @@
+// object_format.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef OBJECT_FORMAT_HH
+#define OBJECT_FORMAT_HH
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "memory_image.hh"
+
+enum class ObjectFormat
+{
+  ASM65,      // "*AAAA" followed by hex bytes, as written by ASM65
+  BINARY,     // raw bytes from the lowest to the highest written address
+  INTEL_HEX,
+  S_RECORD,   // Motorola S19
+  PRG,        // little-endian load address, then as BINARY
+};
+
+struct ObjectFormatInfo
+{
+  const char* name;         // as given on the command line
+  const char* suffix;       // of the object filename
+  const char* description;
+};
+
+const ObjectFormatInfo& get_object_format_info(ObjectFormat format);
+
+std::optional<ObjectFormat> find_object_format(std::string_view name);
+
+// Appends the image in the given format to s. Gaps between written
+// ranges of the BINARY and PRG formats are filled with fill_byte; the
+// other formats only contain written bytes.
+void render_object(std::string& s,
+		   const MemoryImage& image,
+		   ObjectFormat format,
+		   std::uint8_t fill_byte);
+
+#endif // OBJECT_FORMAT_HH
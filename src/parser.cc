@@ -10,31 +10,46 @@
 #include "ast_stack.hh"
 #include "parser.hh"
 #include "grammar.hh"
+#include "utility.hh"
 
 #include <tao/pegtl/analyze.hpp>
 
 ParseError::ParseError():
-  std::runtime_error("Parse error")
+  std::runtime_error("Parse error"),
+  m_column(0)
 {
 }
 
-ParseError::ParseError(const std::string& what):
-  std::runtime_error("Parse error: " + what)
+ParseError::ParseError(const std::string& what,
+		       unsigned column):
+  std::runtime_error("Parse error: " + what),
+  m_column(column)
 {
 }
 
+unsigned ParseError::get_column() const
+{
+  return m_column;
+}
+
 std::shared_ptr<Parser> Parser::create(std::shared_ptr<InstructionSet> instruction_set_sp,
-				       std::shared_ptr<SymbolTable> symbol_table_sp)
+				       std::shared_ptr<SymbolTable> symbol_table_sp,
+				       std::shared_ptr<ASTArena> ast_arena_sp)
 {
-  auto p = new Parser(instruction_set_sp, symbol_table_sp);
+  auto p = new Parser(instruction_set_sp, symbol_table_sp, ast_arena_sp);
   return std::shared_ptr<Parser>(p);
 }
 
 Parser::Parser(std::shared_ptr<InstructionSet> instruction_set_sp,
-	       std::shared_ptr<SymbolTable> symbol_table_sp):
+	       std::shared_ptr<SymbolTable> symbol_table_sp,
+	       std::shared_ptr<ASTArena> ast_arena_sp):
   m_instruction_set_sp(instruction_set_sp),
-  m_symbol_table_sp(symbol_table_sp)
+  m_symbol_table_sp(symbol_table_sp),
+  m_ast_arena_sp(ast_arena_sp),
+  m_source_line_number(0),
+  m_ast_stack(ASTStack::create())
 {
+  m_ast_stack->reserve(INITIAL_AST_STACK_CAPACITY);
 }
 
 void Parser::check_grammar()
@@ -46,46 +61,87 @@ void Parser::check_grammar()
   }
 }
 
-StatementSP Parser::parse(unsigned pass_number,
-			  unsigned source_line_number,
-			  std::uint16_t location_counter,
-			  const std::string& s)
+Statement* Parser::parse(unsigned source_line_number,
+			 std::string_view s)
 {
 #if 0
   check_grammar();
 #endif
 
-  m_pass_number = pass_number;
   m_source_line_number = source_line_number;
-  m_location_counter = location_counter;
+  m_line = s;
 
-  m_ast_stack = ASTStack::create();
+  // a previous line may have left nodes behind if it failed to parse
+  m_ast_stack->clear();
 
-  pegtl::string_input src_line(s, "from line");
+  pegtl::memory_input src_line(s.data(), s.size(), "from line");
 
-  bool result = pegtl::parse<grammar::statement, grammar::action>(src_line, *this);
+  // The grammar actions only see a consistent stack if no rule that
+  // pushed a node was backtracked over. Should one have been, the
+  // stack holds nodes of the wrong kind or the wrong number of them;
+  // that is reported as a syntax error in the line, not an internal
+  // error that abandons the whole assembly.
+  Statement* statement;
+  try
+  {
+    bool result = pegtl::parse<grammar::statement, grammar::action>(src_line, *this);
+
+    if (! result)
+    {
+      throw ParseError("syntax error");
+    }
 
-  if (! result)
+    statement = m_ast_stack->pop<Statement>();
+  }
+  catch (const ASTNodeCastError&)
   {
-    throw ParseError();
+    throw ParseError("syntax error", get_failure_column());
+  }
+  catch (const ASTStackUnderflow&)
+  {
+    throw ParseError("syntax error", get_failure_column());
   }
-
-  StatementSP statement_sp = m_ast_stack->pop<Statement>();
 
   if (! m_ast_stack->empty())
   {
-    throw std::logic_error(std::format("internal error: AST stack has {} leftover items", m_ast_stack->size()));
+    throw ParseError("syntax error", get_failure_column());
   }
 
-  return statement_sp;
+  statement->compile();
+
+  return statement;
+}
+
+// Where the line stops matching a statement, found by matching it again
+// without actions.
+unsigned Parser::get_failure_column() const
+{
+  pegtl::memory_input src_line(m_line.data(), m_line.size(), "from line");
+  pegtl::parse<grammar::statement_body>(src_line);
+  return get_column(src_line.current());
+}
+
+std::span<const InstructionSet::Info> Parser::find_instruction_info(std::string_view mnemonic)
+{
+  return m_instruction_set_sp->find(mnemonic);
+}
+
+SymbolId Parser::intern_symbol(std::string_view name)
+{
+  return m_symbol_table_sp->intern(name);
+}
+
+ASTArena& Parser::get_ast_arena()
+{
+  return *m_ast_arena_sp;
 }
 
-std::uint16_t Parser::get_location_counter() const
+std::string_view Parser::get_line() const
 {
-  return m_location_counter;
+  return m_line;
 }
 
-const std::vector<InstructionSet::Info>& Parser::get_instruction_info(const std::string& mnemonic)
+unsigned Parser::get_column(const char* p) const
 {
-  return m_instruction_set_sp->get(mnemonic);
+  return utility::untabified_column(m_line.substr(0, p - m_line.data())) + 1;
 }
@@ -7,7 +7,9 @@
 #define PARSER_HH
 
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "ast_node.hh"
@@ -15,6 +17,7 @@
 #include "symbol_table.hh"
 #include "value.hh"
 
+class ASTArena;
 class ASTStack;
 using ASTStackSP = std::shared_ptr<ASTStack>;
 
@@ -22,14 +25,21 @@ class ParseError: public std::runtime_error
 {
 public:
   ParseError();
-  ParseError(const std::string& what);
+  ParseError(const std::string& what,
+	     unsigned column = 0);
+
+  unsigned get_column() const;  // one-based, zero if unknown
+
+protected:
+  unsigned m_column;
 };
 
 class Parser
 {
 public:
   static std::shared_ptr<Parser> create(std::shared_ptr<InstructionSet> instruction_set_sp,
-					std::shared_ptr<SymbolTable> symbol_table_sp);
+					std::shared_ptr<SymbolTable> symbol_table_sp,
+					std::shared_ptr<ASTArena> ast_arena_sp);
 
   Parser           (const Parser& ) = delete;  // no copy constructor
   Parser           (      Parser& ) = delete;  // no move constructor
@@ -38,27 +48,43 @@ public:
 
   void check_grammar();
 
-  StatementSP parse(unsigned pass_number,
-		    unsigned source_line_number,
-		    std::uint16_t location_counter,
-		    const std::string& s);
+  // The returned statement is allocated in the parser's AST arena.
+  Statement* parse(unsigned source_line_number,
+		   std::string_view s);
+
+  // returns an empty span if the mnemonic is unrecognized
+  std::span<const InstructionSet::Info> find_instruction_info(std::string_view mnemonic);
 
-  std::uint16_t get_location_counter() const;
+  SymbolId intern_symbol(std::string_view name);
 
-  const std::vector<InstructionSet::Info>& get_instruction_info(const std::string& mnemonic);
+  ASTArena& get_ast_arena();
+
+  std::string_view get_line() const;  // the line being parsed
+
+  // The one-based column of a position in the line being parsed, with
+  // tabs expanded, for diagnostics.
+  unsigned get_column(const char* p) const;
 
 protected:
   Parser(std::shared_ptr<InstructionSet> instruction_set_sp,
-	 std::shared_ptr<SymbolTable> symbol_table_sp);
+	 std::shared_ptr<SymbolTable> symbol_table_sp,
+	 std::shared_ptr<ASTArena> ast_arena_sp);
+
+  // The column at which the line stops matching a statement.
+  unsigned get_failure_column() const;
 
   std::shared_ptr<InstructionSet> m_instruction_set_sp;
   std::shared_ptr<SymbolTable> m_symbol_table_sp;
-  unsigned m_pass_number;
+  std::shared_ptr<ASTArena> m_ast_arena_sp;
   unsigned m_source_line_number;
-  std::uint16_t m_location_counter;
+  std::string_view m_line;
+
+  // The stack is reused for every line; its capacity only grows, so
+  // parsing doesn't allocate once it has seen the deepest line.
+  static constexpr std::size_t INITIAL_AST_STACK_CAPACITY = 32;
 
 public:
-  ASTStackSP m_ast_stack;  // for grammar actions
+  ASTStackSP m_ast_stack;  // for grammar actions, reused across lines
 };
 
 #endif // PARSER_HH
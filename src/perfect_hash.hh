@@ -0,0 +1,240 @@
+// perfect_hash.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef PERFECT_HASH_HH
+#define PERFECT_HASH_HH
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+
+#include "utility.hh"
+
+// Case-insensitive perfect hash tables over a fixed set of keys, built
+// at compile time using "hash and displace": the hash of a key selects
+// a bucket, and each bucket has a displacement, chosen when the table
+// is built, that scatters its keys into otherwise unused slots. A
+// lookup hashes the key once, reads the bucket's displacement and the
+// slot, and does a single key comparison to reject non-members.
+namespace perfect_hash
+{
+  inline constexpr std::size_t NOT_FOUND = std::numeric_limits<std::size_t>::max();
+
+  inline constexpr std::size_t MAX_KEY_LENGTH = 15;
+
+  // Keys are stored by value, downcased, so that they can be computed
+  // (e.g., concatenated) at compile time.
+  class Key
+  {
+  public:
+    constexpr Key() = default;
+
+    constexpr Key(std::string_view s1, std::string_view s2 = "")
+    {
+      if ((s1.size() + s2.size()) > MAX_KEY_LENGTH)
+      {
+	throw std::length_error("perfect_hash: key too long");
+      }
+      for (char c: s1)
+      {
+	m_chars[m_length++] = utility::downcase_character(c);
+      }
+      for (char c: s2)
+      {
+	m_chars[m_length++] = utility::downcase_character(c);
+      }
+    }
+
+    constexpr std::string_view view() const
+    {
+      return std::string_view(m_chars.data(), m_length);
+    }
+
+    constexpr bool operator==(const Key& other) const = default;
+
+  private:
+    std::array<char, MAX_KEY_LENGTH> m_chars {};
+    std::uint8_t m_length = 0;
+  };
+
+  // FNV-1a over the downcased characters
+  constexpr std::uint32_t hash(std::string_view s)
+  {
+    std::uint32_t h = 0x811c9dc5;
+    for (char c: s)
+    {
+      h ^= static_cast<unsigned char>(utility::downcase_character(c));
+      h *= 0x01000193;
+    }
+    return h;
+  }
+
+  // combine a key hash with a displacement, and mix all of the bits
+  // down into the low bits
+  constexpr std::uint32_t displace(std::uint32_t h, std::uint32_t displacement)
+  {
+    h ^= displacement * 0x9e3779b9;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+  }
+
+  template <std::size_t KEY_COUNT>
+  class Table
+  {
+  public:
+    static constexpr std::size_t BUCKET_COUNT = std::bit_ceil(KEY_COUNT / 2 + 1);
+    static constexpr std::size_t SLOT_COUNT   = std::bit_ceil(KEY_COUNT + KEY_COUNT / 2 + 1);
+
+    static_assert(KEY_COUNT < std::numeric_limits<std::uint16_t>::max());
+
+    // Throws (and thus fails compilation) if there are duplicate keys
+    // or no displacement can be found for a bucket.
+    consteval Table(const std::array<Key, KEY_COUNT>& keys):
+      m_keys(keys)
+    {
+      std::array<std::uint32_t, KEY_COUNT> hashes {};
+      std::array<std::size_t, BUCKET_COUNT> bucket_sizes {};
+      for (std::size_t i = 0; i < KEY_COUNT; i++)
+      {
+	for (std::size_t j = 0; j < i; j++)
+	{
+	  if (keys[j] == keys[i])
+	  {
+	    throw std::logic_error("perfect_hash: duplicate key");
+	  }
+	}
+	hashes[i] = hash(keys[i].view());
+	++bucket_sizes[get_bucket(hashes[i])];
+      }
+
+      // place the largest buckets first, while the table is emptiest
+      std::array<std::size_t, BUCKET_COUNT> bucket_order {};
+      for (std::size_t b = 0; b < BUCKET_COUNT; b++)
+      {
+	bucket_order[b] = b;
+      }
+      std::sort(bucket_order.begin(), bucket_order.end(),
+		[&] (std::size_t b1, std::size_t b2)
+		{
+		  if (bucket_sizes[b1] != bucket_sizes[b2])
+		  {
+		    return bucket_sizes[b1] > bucket_sizes[b2];
+		  }
+		  return b1 < b2;
+		});
+
+      m_displacements.fill(0);
+      m_slots.fill(EMPTY_SLOT);
+      for (std::size_t bucket: bucket_order)
+      {
+	if (! bucket_sizes[bucket])
+	{
+	  break;
+	}
+	std::uint32_t displacement = 1;
+	while (! try_place_bucket(bucket, displacement, hashes))
+	{
+	  if (++displacement == MAX_DISPLACEMENT)
+	  {
+	    throw std::logic_error("perfect_hash: can't place bucket");
+	  }
+	}
+	m_displacements[bucket] = displacement;
+      }
+    }
+
+    // returns the index of the key in the array the table was built
+    // from, or NOT_FOUND
+    constexpr std::size_t find(std::string_view s) const
+    {
+      if (s.size() > MAX_KEY_LENGTH)
+      {
+	return NOT_FOUND;
+      }
+      std::uint32_t h = hash(s);
+      std::uint16_t index = m_slots[get_slot(h, m_displacements[get_bucket(h)])];
+      if (index == EMPTY_SLOT)
+      {
+	return NOT_FOUND;
+      }
+      std::string_view key = m_keys[index].view();
+      if (key.size() != s.size())
+      {
+	return NOT_FOUND;
+      }
+      for (std::size_t i = 0; i < s.size(); i++)
+      {
+	if (utility::downcase_character(s[i]) != key[i])
+	{
+	  return NOT_FOUND;
+	}
+      }
+      return index;
+    }
+
+    constexpr std::string_view get_key(std::size_t index) const
+    {
+      return m_keys[index].view();
+    }
+
+  private:
+    static constexpr std::uint16_t EMPTY_SLOT = std::numeric_limits<std::uint16_t>::max();
+    static constexpr std::uint32_t MAX_DISPLACEMENT = 1 << 20;
+
+    static constexpr std::size_t get_bucket(std::uint32_t h)
+    {
+      return displace(h, 0) % BUCKET_COUNT;
+    }
+
+    static constexpr std::size_t get_slot(std::uint32_t h, std::uint32_t displacement)
+    {
+      return displace(h, displacement) % SLOT_COUNT;
+    }
+
+    // place all of the keys of a bucket, or none of them
+    constexpr bool try_place_bucket(std::size_t bucket,
+				    std::uint32_t displacement,
+				    const std::array<std::uint32_t, KEY_COUNT>& hashes)
+    {
+      std::array<std::size_t, KEY_COUNT> placed {};
+      std::size_t placed_count = 0;
+      for (std::size_t i = 0; i < KEY_COUNT; i++)
+      {
+	if (get_bucket(hashes[i]) != bucket)
+	{
+	  continue;
+	}
+	std::size_t slot = get_slot(hashes[i], displacement);
+	if (m_slots[slot] != EMPTY_SLOT)
+	{
+	  while (placed_count)
+	  {
+	    m_slots[placed[--placed_count]] = EMPTY_SLOT;
+	  }
+	  return false;
+	}
+	m_slots[slot] = static_cast<std::uint16_t>(i);
+	placed[placed_count++] = slot;
+      }
+      return true;
+    }
+
+    std::array<Key, KEY_COUNT> m_keys;
+    std::array<std::uint32_t, BUCKET_COUNT> m_displacements {};
+    std::array<std::uint16_t, SLOT_COUNT> m_slots {};
+  };
+
+} // end namespace perfect_hash
+
+#endif // PERFECT_HASH_HH
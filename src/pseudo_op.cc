@@ -3,74 +3,91 @@
 // Copyright 2025 Eric Smith
 // SPDX-License-Identifier: GPL-3.0-only
 
+#include <array>
 #include <format>
 #include <stdexcept>
 
-#include <magic_enum_utility.hpp>
-
+#include "perfect_hash.hh"
 #include "pseudo_op.hh"
-#include "utility.hh"
 
 using enum PseudoOp::PseudoOpEnum;
 using enum PseudoOp::Flag;
 
+constexpr magic_enum::containers::array<PseudoOp::PseudoOpEnum, PseudoOp::Info> s_by_enum
+{
+  PseudoOp::Info { ".ascii",  ASCII },
+  PseudoOp::Info { ".byte",   BYTE },
+  PseudoOp::Info { ".def",    DEF },
+  PseudoOp::Info { ".end",    END },
+  PseudoOp::Info { ".hbyte",  HBYTE },
+  PseudoOp::Info { ".link",   LINK },
+  PseudoOp::Info { ".list",   LIST },
+  PseudoOp::Info { ".loc",    LOC },
+  PseudoOp::Info { ".nolist", NOLIST },
+  PseudoOp::Info { ".page",   PAGE },
+  PseudoOp::Info { ".word",   WORD },
+};
+
+constexpr std::size_t PSEUDO_OP_COUNT = magic_enum::enum_count<PseudoOp::PseudoOpEnum>();
+
+constexpr bool by_enum_in_order()
+{
+  for (PseudoOp::PseudoOpEnum pseudo_op: magic_enum::enum_values<PseudoOp::PseudoOpEnum>())
+  {
+    if (s_by_enum[pseudo_op].pseudo_op != pseudo_op)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(by_enum_in_order(), "PseudoOp: s_by_enum table out of order");
+
+// key n is the mnemonic of the pseudo-op with enum index n
+constexpr std::array<perfect_hash::Key, PSEUDO_OP_COUNT> pseudo_op_keys()
+{
+  std::array<perfect_hash::Key, PSEUDO_OP_COUNT> keys {};
+  for (std::size_t n = 0; n < PSEUDO_OP_COUNT; n++)
+  {
+    keys[n] = perfect_hash::Key(s_by_enum[magic_enum::enum_value<PseudoOp::PseudoOpEnum>(n)].mnemonic);
+  }
+  return keys;
+}
+
+constexpr perfect_hash::Table<PSEUDO_OP_COUNT> s_by_mnemonic(pseudo_op_keys());
+
+static_assert(s_by_mnemonic.find(".ASCII") == static_cast<std::size_t>(PseudoOp::PseudoOpEnum::ASCII));
+static_assert(s_by_mnemonic.find(".word") == static_cast<std::size_t>(PseudoOp::PseudoOpEnum::WORD));
+static_assert(s_by_mnemonic.find(".wor") == perfect_hash::NOT_FOUND);
+
 std::shared_ptr<PseudoOp> PseudoOp::create()
 {
   auto p = new PseudoOp();
   return std::shared_ptr<PseudoOp>(p);
 }
 
-bool PseudoOp::valid_mnemonic(const std::string& mnemonic)
+bool PseudoOp::valid_mnemonic(std::string_view mnemonic)
 {
-  std::string s = utility::downcase_string(mnemonic);
-  return s_by_mnemonic.contains(s);
+  return s_by_mnemonic.find(mnemonic) != perfect_hash::NOT_FOUND;
 }
 
-const PseudoOp::Info& PseudoOp::lookup_mnemonic(const std::string& mnemonic)
+const PseudoOp::Info& PseudoOp::lookup_mnemonic(std::string_view mnemonic)
 {
-  std::string s = utility::downcase_string(mnemonic);
-  PseudoOpEnum pseudo_op_enum = s_by_mnemonic.at(s);
-  return s_by_enum[pseudo_op_enum];
+  std::size_t n = s_by_mnemonic.find(mnemonic);
+  if (n == perfect_hash::NOT_FOUND)
+  {
+    throw std::out_of_range(std::format("unrecognized pseudo-op {}", mnemonic));
+  }
+  return s_by_enum[magic_enum::enum_value<PseudoOpEnum>(n)];
 }
 
-PseudoOp::PseudoOp()
+const PseudoOp::Info& PseudoOp::get_info(PseudoOpEnum pseudo_op)
 {
-  magic_enum::enum_for_each<PseudoOpEnum>([] (PseudoOpEnum pseudo_op)
-      {
-	if (s_by_enum[pseudo_op].pseudo_op != pseudo_op)
-	{
-	  throw std::logic_error(std::format("PseudoOp: s_by_mnemonic table out of order at entry for {}\n",
-					     magic_enum::enum_name(pseudo_op)));
-	}
-      });
+  return s_by_enum[pseudo_op];
 }
 
-const magic_enum::containers::array<PseudoOp::PseudoOpEnum, PseudoOp::Info> PseudoOp::s_by_enum
-{
-  Info { ".ascii",  ASCII },
-  Info { ".byte",   BYTE },
-  Info { ".def",    DEF },
-  Info { ".end",    END },
-  Info { ".hbyte",  HBYTE },
-  Info { ".link",   LINK },
-  Info { ".list",   LIST },
-  Info { ".loc",    LOC },
-  Info { ".nolist", NOLIST },
-  Info { ".page",   PAGE },
-  Info { ".word",   WORD },
-};
-
-const std::map<std::string, PseudoOp::PseudoOpEnum> PseudoOp::s_by_mnemonic
+PseudoOp::PseudoOp()
 {
-  { ".ascii",  ASCII },
-  { ".byte",   BYTE },
-  { ".def",    DEF },
-  { ".end",    END },
-  { ".hbyte",  HBYTE },
-  { ".link",   LINK },
-  { ".list",   LIST },
-  { ".loc",    LOC },
-  { ".nolist", NOLIST },
-  { ".page",   PAGE },
-  { ".word",   WORD },
-};
+  // all tables are built and checked at compile time
+}
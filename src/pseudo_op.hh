@@ -6,9 +6,8 @@
 #ifndef PSEUDO_OP_HH
 #define PSEUDO_OP_HH
 
-#include <map>
 #include <memory>
-#include <string>
+#include <string_view>
 
 #include <magic_enum.hpp>
 #include <magic_enum_containers.hpp>
@@ -41,21 +40,21 @@ public:
 
   struct Info
   {
-    const std::string mnemonic;
+    std::string_view mnemonic;
     PseudoOpEnum pseudo_op;
     Flags flags = Flags();
   };
 
   static std::shared_ptr<PseudoOp> create();
 
-  static bool valid_mnemonic(const std::string& mnemonic);
-  static const Info& lookup_mnemonic(const std::string& mnemonic);
+  // Mnemonics are matched case-insensitively, using a perfect hash
+  // built at compile time.
+  static bool valid_mnemonic(std::string_view mnemonic);
+  static const Info& lookup_mnemonic(std::string_view mnemonic);
+  static const Info& get_info(PseudoOpEnum pseudo_op);
 
 protected:
   PseudoOp();
-
-  static const magic_enum::containers::array<PseudoOpEnum, Info> s_by_enum;
-  static const std::map<std::string, PseudoOpEnum> s_by_mnemonic;
 };
 
 #endif // PSEUDO_OP_HH
@@ -0,0 +1,139 @@
+// source_buffer.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "source_buffer.hh"
+
+SourceBufferError::SourceBufferError(const std::string& what):
+  std::runtime_error("Source error: " + what)
+{
+}
+
+std::shared_ptr<SourceBuffer> SourceBuffer::create(const std::filesystem::path& filename)
+{
+  auto p = new SourceBuffer(filename);
+  return std::shared_ptr<SourceBuffer>(p);
+}
+
+SourceBuffer::SourceBuffer(const std::filesystem::path& filename):
+  m_data(nullptr),
+  m_size(0),
+  m_mapping(nullptr)
+{
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    throw SourceBufferError("can't open source file");
+  }
+
+  struct stat st;
+  if ((::fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0))
+  {
+    void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED)
+    {
+      ::madvise(p, st.st_size, MADV_SEQUENTIAL);
+      m_mapping = p;
+      m_data = static_cast<const char*>(p);
+      m_size = st.st_size;
+    }
+  }
+  if (! m_mapping)
+  {
+    try
+    {
+      read_file(fd);
+    }
+    catch (...)
+    {
+      ::close(fd);
+      throw;
+    }
+  }
+  ::close(fd);  // the mapping, if any, remains valid
+
+  index_lines();
+}
+
+SourceBuffer::~SourceBuffer()
+{
+  if (m_mapping)
+  {
+    ::munmap(m_mapping, m_size);
+  }
+}
+
+void SourceBuffer::read_file(int fd)
+{
+  static constexpr std::size_t READ_CHUNK_SIZE = 65536;
+  std::size_t size = 0;
+  while (true)
+  {
+    m_buffer.resize(size + READ_CHUNK_SIZE);
+    ssize_t count = ::read(fd, m_buffer.data() + size, READ_CHUNK_SIZE);
+    if (count < 0)
+    {
+      if (errno == EINTR)
+      {
+	continue;
+      }
+      throw SourceBufferError(std::format("error reading source file: {}", std::strerror(errno)));
+    }
+    if (count == 0)
+    {
+      break;
+    }
+    size += count;
+  }
+  m_buffer.resize(size);
+  m_data = m_buffer.data();
+  m_size = size;
+}
+
+void SourceBuffer::index_lines()
+{
+  // memchr is vectorized by the C library, so this runs at close to
+  // memory bandwidth even for very large sources.
+  m_line_starts.clear();
+  m_line_starts.reserve(m_size / 32 + 2);
+  m_line_starts.push_back(0);
+  const char* p = m_data;
+  const char* end = m_data + m_size;
+  while (p < end)
+  {
+    const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (! nl)
+    {
+      break;
+    }
+    p = nl + 1;
+    m_line_starts.push_back(p - m_data);
+  }
+  if (m_line_starts.back() != m_size)
+  {
+    // last line has no terminator
+    m_line_starts.push_back(m_size + 1);
+  }
+}
+
+std::size_t SourceBuffer::line_count() const
+{
+  return m_line_starts.size() - 1;
+}
+
+std::string_view SourceBuffer::get_line(std::size_t index) const
+{
+  std::size_t start = m_line_starts[index];
+  std::size_t end = m_line_starts[index + 1] - 1;
+  return std::string_view(m_data + start, end - start);
+}
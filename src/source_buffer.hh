@@ -0,0 +1,58 @@
+// source_buffer.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef SOURCE_BUFFER_HH
+#define SOURCE_BUFFER_HH
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class SourceBufferError: public std::runtime_error
+{
+public:
+  SourceBufferError(const std::string& what);
+};
+
+// A source file held in memory in its entirety, with an index of line
+// start offsets. Regular files are memory mapped; anything else (e.g.,
+// a pipe) is read into an owned buffer. Lines are returned as views
+// into the buffer, without the line terminator, and remain valid for
+// the lifetime of the SourceBuffer.
+class SourceBuffer
+{
+public:
+  static std::shared_ptr<SourceBuffer> create(const std::filesystem::path& filename);
+  ~SourceBuffer();
+
+  SourceBuffer           (const SourceBuffer& ) = delete;  // no copy constructor
+  SourceBuffer           (      SourceBuffer& ) = delete;  // no move constructor
+  SourceBuffer& operator=(const SourceBuffer& ) = delete;  // no copy assignment
+  SourceBuffer& operator=(      SourceBuffer&&) = delete;  // no move assignment
+
+  std::size_t line_count() const;
+  std::string_view get_line(std::size_t index) const;  // zero-indexed
+
+protected:
+  SourceBuffer(const std::filesystem::path& filename);
+
+  void read_file(int fd);
+  void index_lines();
+
+  const char* m_data;
+  std::size_t m_size;
+  void* m_mapping;                  // nullptr if not memory mapped
+  std::vector<char> m_buffer;       // contents, if not memory mapped
+
+  // Start offset of each line, followed by a sentinel one past the
+  // end of the last line's terminator.
+  std::vector<std::size_t> m_line_starts;
+};
+
+#endif // SOURCE_BUFFER_HH
@@ -0,0 +1,158 @@
+// spsc_ring.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef SPSC_RING_HH
+#define SPSC_RING_HH
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A bounded queue from one producer thread to one consumer thread.
+// Pushing and popping don't lock; the mutex and condition variable
+// are only used by the consumer to sleep while the ring is empty, and
+// the producer only touches them if the consumer is sleeping.
+template <typename T>
+class SpscRing
+{
+public:
+  explicit SpscRing(std::size_t capacity);  // rounded up to a power of two
+
+  SpscRing           (const SpscRing& ) = delete;  // no copy constructor
+  SpscRing           (      SpscRing& ) = delete;  // no move constructor
+  SpscRing& operator=(const SpscRing& ) = delete;  // no copy assignment
+  SpscRing& operator=(      SpscRing&&) = delete;  // no move assignment
+
+  // producer
+  bool try_push(const T& item);  // false if full
+  void push(const T& item);      // waits for space
+  void close();                  // no more items will be pushed
+
+  // consumer; waits for an item, and returns false once the ring is
+  // closed and empty
+  bool pop(T& item);
+
+private:
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  bool try_pop(T& item);
+  bool empty() const;  // consumer only
+  void wake_consumer();
+
+  std::vector<T> m_items;
+  std::size_t m_mask;
+
+  // free running indices, kept on separate cache lines
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_head;  // next item to pop
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_tail;  // next item to push
+
+  alignas(CACHE_LINE_SIZE) std::atomic<bool> m_closed;
+  std::atomic<bool> m_consumer_waiting;
+  std::mutex m_mutex;
+  std::condition_variable m_item_pushed;
+};
+
+template <typename T>
+SpscRing<T>::SpscRing(std::size_t capacity):
+  m_items(std::bit_ceil(std::max<std::size_t>(capacity, 2))),
+  m_mask(m_items.size() - 1),
+  m_head(0),
+  m_tail(0),
+  m_closed(false),
+  m_consumer_waiting(false)
+{
+}
+
+template <typename T>
+bool SpscRing<T>::try_push(const T& item)
+{
+  std::size_t tail = m_tail.load(std::memory_order_relaxed);
+  if (tail - m_head.load(std::memory_order_acquire) == m_items.size())
+  {
+    return false;
+  }
+  m_items[tail & m_mask] = item;
+  // Sequentially consistent, so that either the consumer sees the new
+  // tail before it sleeps, or the producer sees that it is sleeping.
+  m_tail.store(tail + 1);
+  if (m_consumer_waiting.load())
+  {
+    wake_consumer();
+  }
+  return true;
+}
+
+template <typename T>
+void SpscRing<T>::push(const T& item)
+{
+  while (! try_push(item))
+  {
+    std::this_thread::yield();
+  }
+}
+
+template <typename T>
+void SpscRing<T>::close()
+{
+  m_closed.store(true);
+  wake_consumer();
+}
+
+template <typename T>
+bool SpscRing<T>::pop(T& item)
+{
+  while (true)
+  {
+    if (try_pop(item))
+    {
+      return true;
+    }
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_consumer_waiting.store(true);
+      m_item_pushed.wait(lock, [this] { return (! empty()) || m_closed.load(); });
+      m_consumer_waiting.store(false);
+    }
+    if (empty())
+    {
+      return false;  // closed
+    }
+  }
+}
+
+template <typename T>
+bool SpscRing<T>::try_pop(T& item)
+{
+  std::size_t head = m_head.load(std::memory_order_relaxed);
+  if (head == m_tail.load(std::memory_order_acquire))
+  {
+    return false;
+  }
+  item = m_items[head & m_mask];
+  m_head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool SpscRing<T>::empty() const
+{
+  return m_head.load(std::memory_order_relaxed) == m_tail.load();
+}
+
+template <typename T>
+void SpscRing<T>::wake_consumer()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+  }
+  m_item_pushed.notify_one();
+}
+
+#endif // SPSC_RING_HH
@@ -0,0 +1,16 @@
+// symbol_id.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef SYMBOL_ID_HH
+#define SYMBOL_ID_HH
+
+#include <cstdint>
+
+// Symbols are interned: each distinct case-folded name is assigned a
+// dense ID when first seen by the parser, and the AST, values, and
+// symbol table refer to the symbol only by that ID.
+using SymbolId = std::uint32_t;
+
+#endif // SYMBOL_ID_HH
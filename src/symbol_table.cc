@@ -4,6 +4,7 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
 #include "symbol_table.hh"
+#include "utility.hh"
 
 SymbolTableError::SymbolTableError(const std::string& what):
   std::runtime_error("Symbol table error: " + what)
@@ -37,84 +38,166 @@ std::shared_ptr<SymbolTable> SymbolTable::create()
 }
 
 SymbolTable::SymbolTable():
-  m_lookup_undefined_ok(false)
+  m_lookup_undefined_ok(false),
+  m_redefinition_ok(false),
+  m_generation(0)
 {
 }
 
+SymbolId SymbolTable::intern(std::string_view name)
+{
+  m_folded_name.clear();
+  for (char c: name)
+  {
+    m_folded_name += utility::downcase_character(c);
+  }
+  auto it = m_ids_by_name.find(std::string_view(m_folded_name));
+  if (it != m_ids_by_name.end())
+  {
+    return it->second;
+  }
+  SymbolId symbol = m_symbol_table.size();
+  m_symbol_table.emplace_back();
+  m_symbol_table.back().name = m_folded_name;
+  m_ids_by_name.emplace(m_folded_name, symbol);
+  return symbol;
+}
+
+std::size_t SymbolTable::size() const
+{
+  return m_symbol_table.size();
+}
+
+const std::string& SymbolTable::get_symbol_name(SymbolId symbol) const
+{
+  return m_symbol_table.at(symbol).name;
+}
+
+std::string SymbolTable::get_symbol_names(std::span<const SymbolId> symbols) const
+{
+  std::string names;
+  for (SymbolId symbol: symbols)
+  {
+    if (names.size())
+    {
+      names += ",";
+    }
+    names += get_symbol_name(symbol);
+  }
+  return names;
+}
+
 void SymbolTable::set_lookup_undefined_ok(bool value)
 {
   m_lookup_undefined_ok = value;
 }
 
-void SymbolTable::define_symbol(unsigned source_line_number,
-				const std::string& symbol,
-				ValueSP value)
+void SymbolTable::set_redefinition_ok(bool value)
 {
-  if (! m_symbol_table.contains(symbol))
+  m_redefinition_ok = value;
+}
+
+bool SymbolTable::define_symbol(unsigned source_line_number,
+				SymbolId symbol,
+				Value value)
+{
+  Entry& entry = m_symbol_table.at(symbol);
+  if (! entry.defined)
   {
-    m_symbol_table.emplace(symbol, Entry { value, source_line_number, {} });
+    entry.defined = true;
+    entry.value = value;
+    entry.definition_line_number = source_line_number;
+    entry.change_generation = ++m_generation;
+    return true;
   }
-  else
+  if (entry.definition_line_number != source_line_number)
   {
-    Entry& entry = m_symbol_table.at(symbol);
-    if (entry.definition_line_number != source_line_number)
-    {
-      throw SymbolMultiplyDefined(symbol, entry.definition_line_number, source_line_number);
-    }
-    std::uint16_t old_value = entry.value->get();
-    std::uint16_t new_value = entry.value->get();
-    if (new_value != old_value)
-    {
-      throw SymbolValueRedefined(symbol, old_value, new_value);
-    }
+    throw SymbolMultiplyDefined(entry.name, entry.definition_line_number, source_line_number);
   }
+  std::uint16_t old_value = entry.value.get();
+  std::uint16_t new_value = value.get();
+  if (new_value == old_value)
+  {
+    return false;
+  }
+  if (! m_redefinition_ok)
+  {
+    throw SymbolValueRedefined(entry.name, old_value, new_value);
+  }
+  entry.value = value;
+  entry.change_generation = ++m_generation;
+  return true;
+}
+
+void SymbolTable::verify_symbol(unsigned source_line_number,
+				SymbolId symbol,
+				Value value) const
+{
+  const Entry& entry = get_defined_entry(symbol);
+  if (entry.definition_line_number != source_line_number)
+  {
+    throw SymbolMultiplyDefined(entry.name, entry.definition_line_number, source_line_number);
+  }
+  std::uint16_t old_value = entry.value.get();
+  std::uint16_t new_value = value.get();
+  if (new_value != old_value)
+  {
+    throw SymbolValueRedefined(entry.name, old_value, new_value);
+  }
+}
+
+bool SymbolTable::contains(SymbolId symbol) const
+{
+  return m_symbol_table.at(symbol).defined;
+}
+
+std::uint64_t SymbolTable::get_generation() const
+{
+  return m_generation;
 }
 
-bool SymbolTable::contains(const std::string& symbol) const
+std::uint64_t SymbolTable::get_symbol_change_generation(SymbolId symbol) const
 {
-  return m_symbol_table.contains(symbol);
+  return m_symbol_table.at(symbol).change_generation;
 }
 
-ValueSP SymbolTable::lookup_symbol(unsigned source_line_number,
-				   const std::string& symbol)
+Value SymbolTable::lookup_symbol([[maybe_unused]] unsigned source_line_number,
+				 SymbolId symbol) const
 {
-  if (! m_symbol_table.contains(symbol))
+  // References aren't recorded here, so that lookups during a parallel
+  // final pass don't write to the table; the assembler collects them
+  // from the source lines into a cross reference instead.
+  const Entry& entry = m_symbol_table.at(symbol);
+  if (! entry.defined)
   {
     if (m_lookup_undefined_ok)
     {
-      return Value::create(symbol);
-      // Note - this didn't create a placeholder symbol table entry,
-      // so the referencing line number isn't recorded. This should
-      // only happen during pass 1, so in pass 2 it should get defined
-      // properly.
+      return Value::unknown(symbol);
     }
     else
     {
-      throw SymbolTableError(std::format("symbol {} undefined", symbol));
+      throw SymbolTableError(std::format("symbol {} undefined", entry.name));
     }
   }
-  auto entry = m_symbol_table.at(symbol);
-  entry.reference_line_numbers.insert(source_line_number);
-  return m_symbol_table.at(symbol).value;
+  return entry.value;
 }
 
-std::size_t SymbolTable::get_symbol_definition_line(const std::string& symbol) const
+const SymbolTable::Entry& SymbolTable::get_defined_entry(SymbolId symbol) const
 {
-  if (! m_symbol_table.contains(symbol))
+  const Entry& entry = m_symbol_table.at(symbol);
+  if (! entry.defined)
   {
-    throw SymbolTableError(std::format("symbol {} undefined", symbol));
+    throw SymbolTableError(std::format("symbol {} undefined", entry.name));
   }
-  const Entry& entry = m_symbol_table.at(symbol);
-  return entry.definition_line_number;
+  return entry;
 }
 
-const std::set<std::size_t>& SymbolTable::get_symbol_reference_line_numbers(const std::string& symbol) const
+Value SymbolTable::get_symbol_value(SymbolId symbol) const
 {
-  if (! m_symbol_table.contains(symbol))
-  {
-    throw SymbolTableError(std::format("symbol {} undefined", symbol));
-  }
-  
-  const Entry& entry = m_symbol_table.at(symbol);
-  return entry.reference_line_numbers;
+  return get_defined_entry(symbol).value;
+}
+
+std::size_t SymbolTable::get_symbol_definition_line(SymbolId symbol) const
+{
+  return get_defined_entry(symbol).definition_line_number;
 }
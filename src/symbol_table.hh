@@ -8,13 +8,17 @@
 
 #include <cstdint>
 #include <format>
+#include <functional>
 #include <iostream> // XXX debug only
-#include <map>
 #include <memory>
-#include <set>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
+#include "symbol_id.hh"
 #include "value.hh"
 
 struct SymbolTableError: public std::runtime_error
@@ -39,35 +43,82 @@ struct SymbolValueRedefined: public SymbolTableError
 class SymbolTable
 {
 public:
+  static constexpr SymbolId NO_SYMBOL = static_cast<SymbolId>(-1);
+
   static std::shared_ptr<SymbolTable> create();
 
+  // returns the ID of the case-folded name, assigning a new ID if needed
+  SymbolId intern(std::string_view name);
+
+  std::size_t size() const;  // number of interned symbols
+  const std::string& get_symbol_name(SymbolId symbol) const;
+
+  // comma separated names, e.g., for the symbols of a ValueUnknownError
+  std::string get_symbol_names(std::span<const SymbolId> symbols) const;
+
   void set_lookup_undefined_ok(bool value);
 
-  void define_symbol(unsigned source_line_number,
-		     const std::string& symbol,
-		     ValueSP value);
+  // When redefinition is ok, a symbol defined again by the same line
+  // with a different value takes the new value; otherwise that throws
+  // SymbolValueRedefined.
+  void set_redefinition_ok(bool value);
+
+  // returns true if the symbol was newly defined or its value changed
+  bool define_symbol(unsigned source_line_number,
+		     SymbolId symbol,
+		     Value value);
 
-  bool contains(const std::string& symbol) const;
+  // Throws whatever define_symbol would, but never changes the table,
+  // so may be called concurrently once the symbol values are final.
+  void verify_symbol(unsigned source_line_number,
+		     SymbolId symbol,
+		     Value value) const;
 
-  ValueSP lookup_symbol(unsigned source_line_number,
-			const std::string& symbol);
+  bool contains(SymbolId symbol) const;  // true if symbol is defined
 
-  std::size_t get_symbol_definition_line(const std::string& symbol) const;
+  // Every definition or change of a symbol's value is stamped with a
+  // new generation number, so that a cached result computed at some
+  // generation can be checked against the symbols it used.
+  std::uint64_t get_generation() const;
+  std::uint64_t get_symbol_change_generation(SymbolId symbol) const;
 
-  const std::set<std::size_t>& get_symbol_reference_line_numbers(const std::string& symbol) const;
+  // doesn't modify the table, so may be called concurrently
+  Value lookup_symbol(unsigned source_line_number,
+		      SymbolId symbol) const;
+
+  // only for defined symbols
+  Value get_symbol_value(SymbolId symbol) const;
+  std::size_t get_symbol_definition_line(SymbolId symbol) const;
 
 protected:
   SymbolTable();
 
   struct Entry
   {
-    ValueSP value;
+    std::string name;
+    bool defined = false;
+    Value value;
     std::size_t definition_line_number = 0;
-    std::set<std::size_t> reference_line_numbers;
+    std::uint64_t change_generation = 0;
+  };
+
+  const Entry& get_defined_entry(SymbolId symbol) const;
+
+  struct NameHash
+  {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view name) const
+    {
+      return std::hash<std::string_view>{}(name);
+    }
   };
 
   bool m_lookup_undefined_ok;
-  std::map<std::string, Entry> m_symbol_table;
+  bool m_redefinition_ok;
+  std::uint64_t m_generation;
+  std::vector<Entry> m_symbol_table;  // indexed by SymbolId
+  std::unordered_map<std::string, SymbolId, NameHash, std::equal_to<>> m_ids_by_name;
+  std::string m_folded_name;  // scratch buffer for intern()
 };
 
 #endif // SYMBOL_TABLE_HH
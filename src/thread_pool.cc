@@ -0,0 +1,106 @@
+// thread_pool.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <algorithm>
+
+#include "thread_pool.hh"
+
+std::shared_ptr<ThreadPool> ThreadPool::create(unsigned thread_count)
+{
+  auto p = new ThreadPool(thread_count);
+  return std::shared_ptr<ThreadPool>(p);
+}
+
+ThreadPool::ThreadPool(unsigned thread_count):
+  m_unfinished_task_count(0),
+  m_stopping(false)
+{
+  if (! thread_count)
+  {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (unsigned i = 0; i < thread_count; i++)
+  {
+    m_threads.emplace_back(& ThreadPool::run_worker, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_task_queued.notify_all();
+  for (auto& thread: m_threads)
+  {
+    thread.join();
+  }
+}
+
+unsigned ThreadPool::get_thread_count() const
+{
+  return m_threads.size();
+}
+
+void ThreadPool::submit(Task task)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.push_back(std::move(task));
+    ++m_unfinished_task_count;
+  }
+  m_task_queued.notify_one();
+}
+
+void ThreadPool::wait()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_all_done.wait(lock, [this] { return m_unfinished_task_count == 0; });
+  if (m_exception)
+  {
+    std::exception_ptr exception = m_exception;
+    m_exception = nullptr;
+    std::rethrow_exception(exception);
+  }
+}
+
+void ThreadPool::run_worker()
+{
+  while (true)
+  {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_task_queued.wait(lock, [this] { return m_stopping || ! m_tasks.empty(); });
+      if (m_tasks.empty())
+      {
+	return;  // stopping, and nothing left to do
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+
+    std::exception_ptr exception;
+    try
+    {
+      task();
+    }
+    catch (...)
+    {
+      exception = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (exception && ! m_exception)
+    {
+      m_exception = exception;
+    }
+    if (! --m_unfinished_task_count)
+    {
+      m_all_done.notify_all();
+    }
+  }
+}
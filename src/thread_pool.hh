@@ -0,0 +1,63 @@
+// thread_pool.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef THREAD_POOL_HH
+#define THREAD_POOL_HH
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads sharing one task queue. Tasks are run
+// in the order submitted, each by whichever worker is free first, so
+// a worker that drew short tasks goes on to the next rather than
+// waiting behind a long one. Tasks are expected to be coarse, such as
+// assembling a whole source file, so one queue under one mutex is
+// never contended enough to matter.
+class ThreadPool
+{
+public:
+  using Task = std::function<void()>;
+
+  // zero means one thread per hardware thread
+  static std::shared_ptr<ThreadPool> create(unsigned thread_count = 0);
+  ~ThreadPool();
+
+  ThreadPool           (const ThreadPool& ) = delete;  // no copy constructor
+  ThreadPool           (      ThreadPool& ) = delete;  // no move constructor
+  ThreadPool& operator=(const ThreadPool& ) = delete;  // no copy assignment
+  ThreadPool& operator=(      ThreadPool&&) = delete;  // no move assignment
+
+  unsigned get_thread_count() const;
+
+  void submit(Task task);
+
+  // Waits until every submitted task has finished. If any task threw,
+  // rethrows the first exception.
+  void wait();
+
+protected:
+  ThreadPool(unsigned thread_count);
+
+  void run_worker();
+
+  std::vector<std::thread> m_threads;
+
+  std::mutex m_mutex;                   // guards the members below
+  std::condition_variable m_task_queued;
+  std::condition_variable m_all_done;
+  std::deque<Task> m_tasks;
+  std::size_t m_unfinished_task_count;  // queued or running
+  bool m_stopping;
+  std::exception_ptr m_exception;       // first exception thrown by a task
+};
+
+#endif // THREAD_POOL_HH
@@ -6,21 +6,132 @@
 #ifndef UTILITY_HH
 #define UTILITY_HH
 
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace utility
 {
   // upcase and downcase character (only alters Basic Latin letters (A-Z)
   // not dependent on locale
   // does not depend on host character set being ASCII or Unicode
-  char upcase_character(char c);
-  char downcase_character(char c);
+  // (constexpr so that they can be used to build compile-time tables)
+  constexpr char upcase_character(char c)
+  {
+    switch (c)
+    {
+      case 'a': return 'A';
+      case 'b': return 'B';
+      case 'c': return 'C';
+      case 'd': return 'D';
+      case 'e': return 'E';
+      case 'f': return 'F';
+      case 'g': return 'G';
+      case 'h': return 'H';
+      case 'i': return 'I';
+      case 'j': return 'J';
+      case 'k': return 'K';
+      case 'l': return 'L';
+      case 'm': return 'M';
+      case 'n': return 'N';
+      case 'o': return 'O';
+      case 'p': return 'P';
+      case 'q': return 'Q';
+      case 'r': return 'R';
+      case 's': return 'S';
+      case 't': return 'T';
+      case 'u': return 'U';
+      case 'v': return 'V';
+      case 'w': return 'W';
+      case 'x': return 'X';
+      case 'y': return 'Y';
+      case 'z': return 'Z';
+    default:
+      return c;
+    }
+  }
+
+  constexpr char downcase_character(char c)
+  {
+    switch (c)
+    {
+      case 'A': return 'a';
+      case 'B': return 'b';
+      case 'C': return 'c';
+      case 'D': return 'd';
+      case 'E': return 'e';
+      case 'F': return 'f';
+      case 'G': return 'g';
+      case 'H': return 'h';
+      case 'I': return 'i';
+      case 'J': return 'j';
+      case 'K': return 'k';
+      case 'L': return 'l';
+      case 'M': return 'm';
+      case 'N': return 'n';
+      case 'O': return 'o';
+      case 'P': return 'p';
+      case 'Q': return 'q';
+      case 'R': return 'r';
+      case 'S': return 's';
+      case 'T': return 't';
+      case 'U': return 'u';
+      case 'V': return 'v';
+      case 'W': return 'w';
+      case 'X': return 'x';
+      case 'Y': return 'y';
+      case 'Z': return 'z';
+    default:
+      return c;
+    }
+  }
 
   // return a upcased or downcased copy of a string (only alters Basic Latin letters (A-Z))
   // not dependent on locale
   // does not depend on host character set being ASCII or Unicode
-  std::string upcase_string(const std::string& s);
-  std::string downcase_string(const std::string& s);
+  std::string upcase_string(std::string_view s);
+  std::string downcase_string(std::string_view s);
+
+  // Source lines have tab stops at every eighth column.
+  constexpr std::size_t TAB_WIDTH = 8;
+
+  // the column after s, if s starts at column start_column, with tabs
+  // expanded
+  std::size_t untabified_column(std::string_view s,
+				std::size_t start_column = 0);
+
+  // the two hex digits of each byte value, so that output can be
+  // formatted by table lookup rather than with std::format
+  using HexDigitTable = std::array<std::array<char, 2>, 256>;
+
+  constexpr HexDigitTable make_hex_digit_table(bool uppercase)
+  {
+    constexpr char upper_digits[] = "0123456789ABCDEF";
+    constexpr char lower_digits[] = "0123456789abcdef";
+    const char* digits = uppercase ? upper_digits : lower_digits;
+    HexDigitTable table {};
+    for (unsigned i = 0; i < table.size(); i++)
+    {
+      table[i] = { digits[i >> 4], digits[i & 0xf] };
+    }
+    return table;
+  }
+
+  inline void append_hex(std::string& s,
+			 const HexDigitTable& table,
+			 std::uint8_t byte)
+  {
+    s.append(table[byte].data(), 2);
+  }
+
+  inline void append_hex(std::string& s,
+			 const HexDigitTable& table,
+			 std::uint16_t word)
+  {
+    s.append(table[word >> 8].data(), 2);
+    s.append(table[word & 0xff].data(), 2);
+  }
 
 } // end namespace utility
 
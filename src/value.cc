@@ -3,7 +3,8 @@
 // Copyright 2025 Eric Smith
 // SPDX-License-Identifier: GPL-3.0-only
 
-#include <ranges>
+#include <algorithm>
+#include <format>
 
 #include "value.hh"
 
@@ -12,15 +13,17 @@ ValueError::ValueError(const std::string& what):
 {
 }
 
-static std::string join(const std::set<std::string>& elems, const std::string& delim = ",")
+// The symbols are only known here by ID; SymbolTable::get_symbol_names()
+// resolves them for a message.
+ValueUnknownError::ValueUnknownError(std::span<const SymbolId> unknown_symbols):
+  ValueError(std::format("{} unknown symbols", unknown_symbols.size())),
+  m_unknown_symbols(unknown_symbols.begin(), unknown_symbols.end())
 {
-  return elems | std::views::join_with(delim) | std::ranges::to<std::string>();
 }
 
-ValueUnknownError::ValueUnknownError(const std::set<std::string>& unknown_symbols):
-  ValueError("unknown symbols " + join(unknown_symbols)),
-  m_unknown_symbols(unknown_symbols)
+const std::vector<SymbolId>& ValueUnknownError::get_unknown_symbols() const
 {
+  return m_unknown_symbols;
 }
 
 ValueDivideByZeroError::ValueDivideByZeroError():
@@ -28,40 +31,29 @@ ValueDivideByZeroError::ValueDivideByZeroError():
 {
 }
 
-std::shared_ptr<Value> Value::create(std::uint16_t value)
-{
-  auto p = new Value(value);
-  return std::shared_ptr<Value>(p);
-}
-
-std::shared_ptr<Value> Value::create(const std::string& unknown_symbol)
-{
-  auto p = new Value(unknown_symbol);
-  return std::shared_ptr<Value>(p);
-}
-
-std::shared_ptr<Value> Value::create(const std::set<std::string>& unknown_symbols)
+Value::Value():
+  m_known(false),
+  m_unknown_symbols_truncated(false),
+  m_unknown_symbol_count(0),
+  m_value(0),
+  m_unknown_symbols()
 {
-  auto p = new Value(unknown_symbols);
-  return std::shared_ptr<Value>(p);
 }
 
 Value::Value(std::uint16_t value):
   m_known(true),
-  m_value(value)
+  m_unknown_symbols_truncated(false),
+  m_unknown_symbol_count(0),
+  m_value(value),
+  m_unknown_symbols()
 {
 }
 
-Value::Value(const std::string& unknown_symbol):
-  m_known(false)
-{
-  m_unknown_symbols.insert(unknown_symbol);
-}
-
-Value::Value(const std::set<std::string>& unknown_symbols):
-  m_known(false),
-  m_unknown_symbols(unknown_symbols)
+Value Value::unknown(SymbolId unknown_symbol)
 {
+  Value v;
+  v.m_unknown_symbols[v.m_unknown_symbol_count++] = unknown_symbol;
+  return v;
 }
 
 bool Value::known() const
@@ -75,86 +67,111 @@ std::uint16_t Value::get() const
   {
     return m_value;
   }
-  throw ValueUnknownError(m_unknown_symbols);
+  throw ValueUnknownError(get_unknown_symbols());
 }
 
-const std::set<std::string>& Value::get_unknown_symbols() const
+ValueExpected<std::uint16_t> Value::try_get() const
 {
-  return m_unknown_symbols;
+  if (m_known)
+  {
+    return m_value;
+  }
+  return std::unexpected(ValueErrorKind::UNKNOWN);
 }
 
-static std::set<std::string> merge_unknowns(const ValueSP& left,
-					    const ValueSP& right)
+std::span<const SymbolId> Value::get_unknown_symbols() const
 {
-  std::set<std::string> unknowns;
-  if (! left->known())
-  {
-    auto ls = left->get_unknown_symbols();
-    unknowns.insert(ls.begin(), ls.end());
-  }
-  if (! right->known())
+  return std::span<const SymbolId>(m_unknown_symbols.data(), m_unknown_symbol_count);
+}
+
+bool Value::unknown_symbols_truncated() const
+{
+  return m_unknown_symbols_truncated;
+}
+
+Value merge_unknowns(const Value& left,
+		     const Value& right)
+{
+  Value v;
+  for (const Value* operand: { &left, &right })
   {
-    auto rs = right->get_unknown_symbols();
-    unknowns.insert(rs.begin(), rs.end());
+    if (operand->known())
+    {
+      continue;
+    }
+    v.m_unknown_symbols_truncated |= operand->m_unknown_symbols_truncated;
+    for (SymbolId symbol: operand->get_unknown_symbols())
+    {
+      auto recorded = v.get_unknown_symbols();
+      if (std::find(recorded.begin(), recorded.end(), symbol) != recorded.end())
+      {
+	continue;
+      }
+      if (v.m_unknown_symbol_count == Value::MAX_UNKNOWN_SYMBOLS)
+      {
+	v.m_unknown_symbols_truncated = true;
+	break;
+      }
+      v.m_unknown_symbols[v.m_unknown_symbol_count++] = symbol;
+    }
   }
-  return unknowns;
+  return v;
 }
 
-ValueSP operator+(const ValueSP& left, const ValueSP& right)
+Value operator+(const Value& left, const Value& right)
 {
-  if (left->known() && right->known())
+  if (left.known() && right.known())
   {
-    return Value::create(left->get() + right->get());
+    return Value(left.get() + right.get());
   }
-  return Value::create(merge_unknowns(left, right));
+  return merge_unknowns(left, right);
 }
 
-ValueSP operator-(const ValueSP& left, const ValueSP& right)
+Value operator-(const Value& left, const Value& right)
 {
-  if (left->known() && right->known())
+  if (left.known() && right.known())
   {
-    return Value::create(left->get() - right->get());
+    return Value(left.get() - right.get());
   }
-  return Value::create(merge_unknowns(left, right));
+  return merge_unknowns(left, right);
 }
 
-ValueSP operator*(const ValueSP& left, const ValueSP& right)
+Value operator*(const Value& left, const Value& right)
 {
-  if (left->known() && right->known())
+  if (left.known() && right.known())
   {
-    return Value::create(left->get() * right->get());
+    return Value(left.get() * right.get());
   }
-  return Value::create(merge_unknowns(left, right));
+  return merge_unknowns(left, right);
 }
 
-ValueSP operator/(const ValueSP& left, const ValueSP& right)
+Value operator/(const Value& left, const Value& right)
 {
-  if (left->known() && right->known())
+  if (left.known() && right.known())
   {
-    if (right->get() == 0)
+    if (right.get() == 0)
     {
       throw ValueDivideByZeroError();
     }
-    return Value::create(left->get() / right->get());
+    return Value(left.get() / right.get());
   }
-  return Value::create(merge_unknowns(left, right));
+  return merge_unknowns(left, right);
 }
 
-ValueSP low_byte(const ValueSP& operand)
+Value low_byte(const Value& operand)
 {
-  if (operand->known())
+  if (operand.known())
   {
-    return Value::create(operand->get() & 0xff);
+    return Value(operand.get() & 0xff);
   }
   return operand;
 }
 
-ValueSP high_byte(const ValueSP& operand)
+Value high_byte(const Value& operand)
 {
-  if (operand->known())
+  if (operand.known())
   {
-    return Value::create(operand->get() >> 8);
+    return Value(operand.get() >> 8);
   }
   return operand;
 }
-
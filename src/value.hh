@@ -6,13 +6,17 @@
 #ifndef VALUE_HH
 #define VALUE_HH
 
+#include <array>
 #include <cstdint>
-#include <memory>
-#include <set>
+#include <expected>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+#include "symbol_id.hh"
+
 class ValueError: public std::runtime_error
 {
 public:
@@ -22,10 +26,12 @@ public:
 class ValueUnknownError: public ValueError
 {
 public:
-  ValueUnknownError(const std::set<std::string>& unknown_symbols);
+  ValueUnknownError(std::span<const SymbolId> unknown_symbols);
+
+  const std::vector<SymbolId>& get_unknown_symbols() const;
 
 protected:
-  const std::set<std::string>& m_unknown_symbols;
+  std::vector<SymbolId> m_unknown_symbols;
 };
 
 class ValueDivideByZeroError: public ValueError
@@ -34,38 +40,60 @@ public:
   ValueDivideByZeroError();
 };
 
+// Reasons that a number can't be produced from a value or expression.
+// These are ordinary outcomes, e.g., forward references in pass 1, so
+// they are returned rather than thrown.
+enum class ValueErrorKind
+{
+  UNKNOWN,         // depends on symbols that are not yet defined
+  DIVIDE_BY_ZERO,
+};
+
+template <typename T>
+using ValueExpected = std::expected<T, ValueErrorKind>;
+
+// A value is either known, or unknown due to references to symbols
+// that are not yet defined. Values are small and trivially copyable,
+// and are passed and returned by value. Up to MAX_UNKNOWN_SYMBOLS of
+// the symbols responsible for an unknown value are recorded; any
+// beyond that are only noted by unknown_symbols_truncated().
+//
 // This might be more convenient as a template
 //     template<typename T>
 // rather than hardwiring it to std::uint16_t
 class Value
 {
 public:
-  static std::shared_ptr<Value> create(std::uint16_t value);
-  static std::shared_ptr<Value> create(const std::string& unknown_symbol);
-  static std::shared_ptr<Value> create(const std::set<std::string>& unknown_symbols);
+  static constexpr std::size_t MAX_UNKNOWN_SYMBOLS = 4;
+
+  Value();  // unknown, with no unknown symbols recorded
+  Value(std::uint16_t value);
+  static Value unknown(SymbolId unknown_symbol);
 
   bool known() const;
-  std::uint16_t get() const;
-  const std::set<std::string>& get_unknown_symbols() const;
+  std::uint16_t get() const;             // throws ValueUnknownError if unknown
+  ValueExpected<std::uint16_t> try_get() const;
+  std::span<const SymbolId> get_unknown_symbols() const;
+  bool unknown_symbols_truncated() const;
 
-protected:
-  Value(std::uint16_t value);
-  Value(const std::string& unknown_symbol);
-  Value(const std::set<std::string>& unknown_symbols);
+  friend Value merge_unknowns(const Value& left, const Value& right);
 
+protected:
   bool m_known;
+  bool m_unknown_symbols_truncated;
+  std::uint8_t m_unknown_symbol_count;
   std::uint16_t m_value;
-  std::set<std::string> m_unknown_symbols;
+  std::array<SymbolId, MAX_UNKNOWN_SYMBOLS> m_unknown_symbols;
 };
 
-using ValueSP = std::shared_ptr<Value>;
+static_assert(std::is_trivially_copyable_v<Value>);
 
-ValueSP operator+(const ValueSP& left, const ValueSP& right);
-ValueSP operator-(const ValueSP& left, const ValueSP& right);
-ValueSP operator*(const ValueSP& left, const ValueSP& right);
-ValueSP operator/(const ValueSP& left, const ValueSP& right);
+Value operator+(const Value& left, const Value& right);
+Value operator-(const Value& left, const Value& right);
+Value operator*(const Value& left, const Value& right);
+Value operator/(const Value& left, const Value& right);
 
-ValueSP low_byte(const ValueSP& operand);
-ValueSP high_byte(const ValueSP& operand);
+Value low_byte(const Value& operand);
+Value high_byte(const Value& operand);
 
 #endif // VALUE_HH
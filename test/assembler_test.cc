@@ -0,0 +1,521 @@
+// assembler_test.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "assembler.hh"
+#include "diagnostic.hh"
+#include "instruction_set.hh"
+#include "memory_image.hh"
+#include "object_format.hh"
+#include "pseudo_op.hh"
+#include "test.hh"
+
+struct Options
+{
+  unsigned jobs = 1;
+  bool single_pass = false;
+  bool check_only = false;
+  bool listing = false;
+  std::optional<ObjectFormat> object_format = std::nullopt;
+};
+
+struct Result
+{
+  bool completed;  // assemble() returned rather than throwing
+  std::string error;  // the message of the exception thrown, if not
+  std::vector<Diagnostic> diagnostics;
+  std::vector<Assembler::PassStatistics> pass_statistics;
+  std::shared_ptr<const MemoryImage> memory_image_sp;
+  std::string listing;  // the contents of the files written, if any
+  std::string object;
+};
+
+static std::string read_file(const std::filesystem::path& path)
+{
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+		     std::istreambuf_iterator<char>());
+}
+
+// Assembles a source, writing only the output files asked for.
+static Result assemble(std::string_view name,
+		       std::string_view source,
+		       const Options& options = {})
+{
+  std::filesystem::path path = test::write_source(name, source);
+  std::filesystem::path listing_path = std::filesystem::path(path).replace_extension(".lst");
+  std::filesystem::path object_path = std::filesystem::path(path).replace_extension(".obj");
+  std::filesystem::remove(listing_path);
+  std::filesystem::remove(object_path);
+
+  Result result { .completed = true,
+		  .error = {},
+		  .diagnostics = {},
+		  .pass_statistics = {},
+		  .memory_image_sp = nullptr,
+		  .listing = {},
+		  .object = {} };
+  {
+    // the output files are complete once the assembler is destroyed
+    auto diagnostics_sp = BufferedDiagnosticSink::create();
+    Assembler assembler(InstructionSet::create(), PseudoOp::create(), path);
+    assembler.set_diagnostic_sink(diagnostics_sp);
+    assembler.set_jobs(options.jobs);
+    assembler.set_single_pass(options.single_pass);
+    assembler.set_check_only(options.check_only);
+    if (options.listing)
+    {
+      assembler.set_listing_file(listing_path);
+    }
+    if (options.object_format)
+    {
+      assembler.add_object_file(*options.object_format, object_path);
+    }
+
+    try
+    {
+      assembler.assemble();
+    }
+    catch (const std::exception& e)
+    {
+      result.completed = false;
+      result.error = e.what();
+    }
+    std::span<const Diagnostic> diagnostics = diagnostics_sp->get();
+    result.diagnostics.assign(diagnostics.begin(), diagnostics.end());
+    result.pass_statistics = assembler.get_pass_statistics();
+    result.memory_image_sp = assembler.get_memory_image();
+  }
+  result.listing = read_file(listing_path);
+  result.object = read_file(object_path);
+  return result;
+}
+
+// The bytes written to the memory image from address on, or an empty
+// vector if any of them weren't written.
+static std::vector<std::uint8_t> get_bytes(const Result& result,
+					   std::uint16_t address,
+					   std::size_t count)
+{
+  std::vector<std::uint8_t> bytes;
+  for (std::size_t i = 0; i < count; i++)
+  {
+    std::uint16_t a = address + i;
+    if (! result.memory_image_sp->is_written(a))
+    {
+      return { };
+    }
+    bytes.push_back(result.memory_image_sp->get(a));
+  }
+  return bytes;
+}
+
+// A duplicate label on a line whose size is known from the statement
+// alone is an ordinary line error, as on any other line, rather than
+// ending the assembly. The line keeps its space in every pass, so a
+// later label has the same address in the sizing passes and the final
+// pass, and isn't reported as a phase error.
+static void test_duplicate_label_on_fixed_size_line()
+{
+  static constexpr std::string_view source =
+    "a:\tnop\n"
+    "a:\tnop\n"
+    "b:\tnop\n"
+    "\tlda\tb\n";
+  for (unsigned jobs: { 1, 2 })
+  {
+    Result result = assemble("impala_duplicate_label.p65", source, { .jobs = jobs });
+    CHECK(result.completed);
+    CHECK(result.diagnostics.size() == 1);
+    if (result.diagnostics.size() == 1)
+    {
+      CHECK(result.diagnostics[0].severity == Severity::ERROR);
+      CHECK(result.diagnostics[0].line == 2);
+      CHECK(result.diagnostics[0].message.contains("multiply defined"));
+    }
+    CHECK(get_bytes(result, 0x0000, 1) == std::vector<std::uint8_t>({ 0xea }));
+    CHECK(! result.memory_image_sp->is_written(0x0001));  // the line in error
+    CHECK(get_bytes(result, 0x0002, 3) == std::vector<std::uint8_t>({ 0xea, 0xa5, 0x02 }));  // b: nop, lda b
+  }
+}
+
+// The parser's message for a line that fails to parse is reported by
+// the final pass, rather than a generic one, along with the column
+// where the parser gave up.
+static void test_parse_error_message()
+{
+  static constexpr std::string_view source =
+    "\tlda\t$12345\n"
+    "\tlda\t5 5\n"
+    "\tnop\n";
+  for (unsigned jobs: { 1, 2 })
+  {
+    Result result = assemble("impala_parse_error.p65", source, { .jobs = jobs });
+    CHECK(result.completed);
+    CHECK(result.diagnostics.size() == 2);
+    if (result.diagnostics.size() == 2)
+    {
+      CHECK(result.diagnostics[0].line == 1);
+      CHECK(result.diagnostics[0].column == 17);  // the constant, after two tabs
+      CHECK(result.diagnostics[0].message.contains("numeric constant \"12345\" out of range"));
+      CHECK(result.diagnostics[1].line == 2);
+      CHECK(result.diagnostics[1].column == 19);  // the second operand
+      CHECK(result.diagnostics[1].message.contains("syntax error"));
+    }
+  }
+}
+
+// Assembling over earlier object code is a warning, attributed to the
+// later line, whose bytes are kept.
+static void test_overlap_warning()
+{
+  static constexpr std::string_view source =
+    "\t.loc\t$1000\n"
+    "\tlda#\t1\n"
+    "\t.loc\t$1001\n"
+    "\tnop\n";
+  for (unsigned jobs: { 1, 2 })
+  {
+    Result result = assemble("impala_overlap.p65", source, { .jobs = jobs });
+    CHECK(result.completed);
+    CHECK(result.diagnostics.size() == 1);
+    if (result.diagnostics.size() == 1)
+    {
+      CHECK(result.diagnostics[0].severity == Severity::WARNING);
+      CHECK(result.diagnostics[0].line == 4);
+      CHECK(result.diagnostics[0].message.contains("object code at 1001 overlaps object code from line 2"));
+    }
+    CHECK(get_bytes(result, 0x1000, 2) == std::vector<std::uint8_t>({ 0xa9, 0xea }));
+  }
+}
+
+// A forward reference is sized as absolute in pass 1, and shrinks to
+// zero page in a later sizing pass once its value is known, moving the
+// labels after it.
+static void test_forward_zero_page_reference()
+{
+  static constexpr std::string_view source =
+    "\t.loc\t$1000\n"
+    "\tlda\tzp1\n"
+    "\tjmp\tnext\n"
+    "next:\tnop\n"
+    "\t.def\tzp1=$10\n";
+  for (unsigned jobs: { 1, 2 })
+  {
+    Result result = assemble("impala_forward_zero_page.p65", source, { .jobs = jobs });
+    CHECK(result.completed);
+    CHECK(result.diagnostics.empty());
+    CHECK(get_bytes(result, 0x1000, 6) == std::vector<std::uint8_t>({ 0xa5, 0x10,        // lda zp1
+								       0x4c, 0x05, 0x10,  // jmp next
+								       0xea }));          // nop
+    CHECK(! result.memory_image_sp->is_written(0x1006));
+
+    // pass 1 sized lda as absolute, pass 2 moved next, pass 3 moved
+    // nothing, then the final pass
+    CHECK(result.pass_statistics.size() == 4);
+    if (result.pass_statistics.size() == 4)
+    {
+      CHECK(result.pass_statistics[0].forward_references == 1);
+      CHECK(result.pass_statistics[1].symbols_changed > 0);
+      CHECK(result.pass_statistics[2].symbols_changed == 0);
+      CHECK(result.pass_statistics[3].final_pass);
+    }
+  }
+}
+
+// The size of lda depends on y, which depends on the size of lda:
+// absolute puts y in zero page, and zero page puts it out. Sizing
+// gives up after MAX_SIZING_PASSES.
+static void test_sizing_does_not_converge()
+{
+  static constexpr std::string_view source =
+    "\t.loc\t$fe\n"
+    "\tlda\ty\n"
+    "e:\n"
+    "\t.def\ty=$200-e\n";
+  Result result = assemble("impala_no_convergence.p65", source);
+  CHECK(! result.completed);
+  CHECK(result.error.contains("addresses did not converge after 16 passes"));
+  CHECK(result.pass_statistics.size() == 16);
+}
+
+// In single-pass mode, forward references in operands are left as
+// fixups, applied once the pass is complete. Without a forward .def
+// the output is the same as with sizing passes.
+static void test_single_pass_fixups()
+{
+  static constexpr std::string_view source =
+    "\t.loc\t$1000\n"
+    "\tlda#\t<data\n"
+    "\tldx#\t>data\n"
+    "\tbne\tskip\n"
+    "\tjmp\tdata\n"
+    "skip:\trts\n"
+    "data:\t.byte\t1\n";
+  static const std::vector<std::uint8_t> expected
+  {
+    0xa9, 0x0a,        // lda# <data
+    0xa2, 0x10,        // ldx# >data
+    0xd0, 0x03,        // bne skip
+    0x4c, 0x0a, 0x10,  // jmp data
+    0x60,              // rts
+    0x01,              // .byte 1
+  };
+  Result single = assemble("impala_single_pass.p65", source, { .single_pass = true });
+  CHECK(single.completed);
+  CHECK(single.diagnostics.empty());
+  CHECK(get_bytes(single, 0x1000, expected.size()) == expected);
+  CHECK(single.pass_statistics.size() == 1);
+  if (single.pass_statistics.size() == 1)
+  {
+    CHECK(single.pass_statistics[0].fixup_count == 4);
+  }
+
+  Result multiple = assemble("impala_single_pass.p65", source);
+  CHECK(multiple.completed);
+  CHECK(multiple.diagnostics.empty());
+  bool same = true;
+  for (unsigned address = 0; address < 0x10000; address++)
+  {
+    same = same && (multiple.memory_image_sp->is_written(address) == single.memory_image_sp->is_written(address));
+    same = same && (multiple.memory_image_sp->get(address) == single.memory_image_sp->get(address));
+  }
+  CHECK(same);
+}
+
+// A relative branch fixup that turns out to be out of range is an
+// error on the line of the branch.
+static void test_single_pass_relative_out_of_range()
+{
+  static constexpr std::string_view source =
+    "\t.loc\t$1000\n"
+    "\tbeq\tfar\n"
+    "\t.loc\t$1100\n"
+    "far:\tnop\n";
+  Result result = assemble("impala_single_pass_range.p65", source, { .single_pass = true });
+  CHECK(result.completed);
+  CHECK(result.diagnostics.size() == 1);
+  if (result.diagnostics.size() == 1)
+  {
+    CHECK(result.diagnostics[0].severity == Severity::ERROR);
+    CHECK(result.diagnostics[0].line == 2);
+    CHECK(result.diagnostics[0].message.contains("relative branch displacement 254 out of range"));
+  }
+}
+
+// A symbol still undefined at the end of the source is an error on
+// the line that referenced it.
+static void test_single_pass_undefined_symbol()
+{
+  static constexpr std::string_view source =
+    "\tjmp\tnowhere\n"
+    "\tnop\n";
+  Result result = assemble("impala_single_pass_undefined.p65", source, { .single_pass = true });
+  CHECK(result.completed);
+  CHECK(result.diagnostics.size() == 1);
+  if (result.diagnostics.size() == 1)
+  {
+    CHECK(result.diagnostics[0].severity == Severity::ERROR);
+    CHECK(result.diagnostics[0].line == 1);
+    CHECK(result.diagnostics[0].message.contains("nowhere"));
+  }
+  CHECK(result.memory_image_sp->get(0x0003) == 0xea);  // nop
+}
+
+// Errors from single-pass fixups, and overlap warnings, are only found
+// after the pass, but are still reported in line order, among the
+// errors found by the pass.
+static void test_diagnostics_in_line_order()
+{
+  static constexpr std::string_view fixup_source =
+    "\t.loc\t$1000\n"
+    "\tbeq\tfar\n"
+    "\tlda\t5 5\n"
+    "\t.loc\t$1100\n"
+    "far:\tnop\n";
+  Result result = assemble("impala_fixup_order.p65", fixup_source, { .single_pass = true });
+  CHECK(result.completed);
+  CHECK(result.diagnostics.size() == 2);
+  if (result.diagnostics.size() == 2)
+  {
+    CHECK(result.diagnostics[0].line == 2);
+    CHECK(result.diagnostics[0].message.contains("out of range"));
+    CHECK(result.diagnostics[1].line == 3);
+    CHECK(result.diagnostics[1].message.contains("syntax error"));
+  }
+
+  static constexpr std::string_view overlap_source =
+    "\t.loc\t$1000\n"
+    "\tlda#\t1\n"
+    "\t.loc\t$1001\n"
+    "\tnop\n"
+    "\tlda\t5 5\n";
+  for (bool single_pass: { false, true })
+  {
+    for (unsigned jobs: { 1, 2 })
+    {
+      result = assemble("impala_overlap_order.p65", overlap_source, { .jobs = jobs, .single_pass = single_pass });
+      CHECK(result.completed);
+      CHECK(result.diagnostics.size() == 2);
+      if (result.diagnostics.size() == 2)
+      {
+	CHECK(result.diagnostics[0].severity == Severity::WARNING);
+	CHECK(result.diagnostics[0].line == 4);
+	CHECK(result.diagnostics[1].severity == Severity::ERROR);
+	CHECK(result.diagnostics[1].line == 5);
+      }
+    }
+  }
+}
+
+// A source long enough to be split into chunks, with forward zero
+// page references, branches and jumps both ways, listing control, and
+// errors scattered through it.
+static std::string make_long_source()
+{
+  static constexpr unsigned GROUPS = 600;
+  std::string source = "\t.loc\t$0400\n";
+  for (unsigned i = 0; i < GROUPS; i++)
+  {
+    if (i % 150 == 75)
+    {
+      source += "\t.page\n";
+    }
+    if (i % 200 == 20)
+    {
+      source += "\t.nolist\n";
+    }
+    if (i % 200 == 30)
+    {
+      source += "\t.list\n";
+    }
+    source += std::format("l{}:\tlda\tz{}\n", i, i % 8);
+    source += std::format("\tbne\tl{}\n", i);
+    source += std::format("\tjmp\tl{}\n", (i + 37) % GROUPS);
+    if (i % 97 == 13)
+    {
+      source += std::format("\tlda\tundef{}\n", i);
+    }
+    if (i % 89 == 41)
+    {
+      source += "\tbne\tl0\n";  // out of range
+    }
+  }
+  for (unsigned k = 0; k < 8; k++)
+  {
+    source += std::format("\t.def\tz{}=${:02x}\n", k, k * 2);
+  }
+  return source;
+}
+
+// The parallel final pass writes the same object file and listing, and
+// reports the same diagnostics in the same order, as a serial one.
+static void test_parallel_final_pass_output()
+{
+  std::string source = make_long_source();
+  Options options { .jobs = 1,
+		    .single_pass = false,
+		    .listing = true,
+		    .object_format = ObjectFormat::BINARY };
+  Result serial = assemble("impala_parallel.p65", source, options);
+  CHECK(serial.completed);
+  CHECK(serial.diagnostics.size() == 14);
+  CHECK(std::is_sorted(serial.diagnostics.begin(),
+		       serial.diagnostics.end(),
+		       [](const Diagnostic& a, const Diagnostic& b) { return a.line < b.line; }));
+  CHECK(serial.object.size() > 0);
+  CHECK(serial.listing.size() > 0);
+  for (unsigned jobs: { 2, 3, 7 })
+  {
+    options.jobs = jobs;
+    Result parallel = assemble("impala_parallel.p65", source, options);
+    CHECK(parallel.completed);
+    CHECK(parallel.pass_statistics.back().chunk_count == jobs);
+    CHECK(parallel.object == serial.object);
+    CHECK(parallel.listing == serial.listing);
+    CHECK(parallel.diagnostics.size() == serial.diagnostics.size());
+    if (parallel.diagnostics.size() == serial.diagnostics.size())
+    {
+      for (std::size_t i = 0; i < serial.diagnostics.size(); i++)
+      {
+	CHECK(parallel.diagnostics[i].severity == serial.diagnostics[i].severity);
+	CHECK(parallel.diagnostics[i].line == serial.diagnostics[i].line);
+	CHECK(parallel.diagnostics[i].message == serial.diagnostics[i].message);
+      }
+    }
+  }
+}
+
+// Check-only mode assembles as usual, including a forward .def that
+// single-pass mode couldn't resolve, and reports the same diagnostics,
+// but writes nothing.
+static void test_check_only()
+{
+  static constexpr std::string_view source =
+    "\t.loc\t$1000\n"
+    "\tlda\tfoo\n"
+    "\t.def\tfoo=bar\n"
+    "bar:\tnop\n";
+  for (unsigned jobs: { 1, 2 })
+  {
+    Options options { .jobs = jobs,
+		      .single_pass = false,
+		      .check_only = false,
+		      .listing = true,
+		      .object_format = ObjectFormat::ASM65 };
+    Result normal = assemble("impala_check.p65", source, options);
+    CHECK(normal.completed);
+    CHECK(normal.diagnostics.empty());
+    CHECK(normal.object == "*1000AD0310EA");
+
+    options.check_only = true;
+    Result check = assemble("impala_check.p65", source, options);
+    CHECK(check.completed);
+    CHECK(check.diagnostics.empty());
+    CHECK(check.pass_statistics.size() == normal.pass_statistics.size());
+    CHECK(check.object.empty());
+    CHECK(check.listing.empty());
+  }
+
+  // and reports the same errors as a normal assembly
+  std::string long_source = make_long_source();
+  Result normal = assemble("impala_check_long.p65", long_source);
+  Result check = assemble("impala_check_long.p65", long_source, { .check_only = true });
+  CHECK(check.completed);
+  CHECK(check.diagnostics.size() == normal.diagnostics.size());
+  if (check.diagnostics.size() == normal.diagnostics.size())
+  {
+    for (std::size_t i = 0; i < normal.diagnostics.size(); i++)
+    {
+      CHECK(check.diagnostics[i].line == normal.diagnostics[i].line);
+      CHECK(check.diagnostics[i].message == normal.diagnostics[i].message);
+    }
+  }
+}
+
+int main()
+{
+  test_duplicate_label_on_fixed_size_line();
+  test_parse_error_message();
+  test_overlap_warning();
+  test_forward_zero_page_reference();
+  test_sizing_does_not_converge();
+  test_single_pass_fixups();
+  test_single_pass_relative_out_of_range();
+  test_single_pass_undefined_symbol();
+  test_diagnostics_in_line_order();
+  test_parallel_final_pass_output();
+  test_check_only();
+  return test::result();
+}
@@ -0,0 +1,168 @@
+// listing_test.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "assembler.hh"
+#include "diagnostic.hh"
+#include "instruction_set.hh"
+#include "pseudo_op.hh"
+#include "test.hh"
+
+// Assembles a source from the temporary directory, which is the
+// current directory, so that the title in the page headers doesn't
+// depend on where that is, and returns the listing.
+static std::string assemble_listing(std::string_view name,
+				    std::string_view source,
+				    unsigned page_length,
+				    unsigned jobs)
+{
+  test::write_source(name, source);
+  std::filesystem::path path(name);
+  std::filesystem::path listing_path = std::filesystem::path(path).replace_extension(".lst");
+  {
+    Assembler assembler(InstructionSet::create(), PseudoOp::create(), path);
+    assembler.set_diagnostic_sink(BufferedDiagnosticSink::create());
+    assembler.set_jobs(jobs);
+    assembler.set_listing_file(listing_path);
+    assembler.set_listing_page_length(page_length);
+    assembler.assemble();
+  }
+  std::ifstream file(listing_path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+		     std::istreambuf_iterator<char>());
+}
+
+// Lines 5 to 7 are in a .NOLIST region, including the nested .NOLIST,
+// which one .LIST ends. The .PAGE on line 10 isn't listed, but starts
+// a new page. Each half of the symbol table starts a new page, and
+// continues on the next.
+static void test_pagination()
+{
+  static constexpr std::string_view source =
+    "; listing test\n"
+    "\t.loc\t$1000\n"
+    "start:\tlda#\t1\n"
+    "\t.nolist\n"
+    "\tnop\n"
+    "\t.nolist\n"
+    "\tnop\n"
+    "\t.list\n"
+    "\tsta\tzp1\n"
+    "\t.page\n"
+    "\tjmp\tstart\n"
+    "loop:\tdex\n"
+    "\tbne\tloop\n"
+    "\t.def\tzp1=$10\n"
+    "\t.def\tone=1\n"
+    "\t.def\ttwo=2\n"
+    "\t.def\tthree=3\n";
+  static constexpr std::string_view expected =
+    "impala 6502 assembler    impala_listing.p65                        page    1\n"
+    "\n"
+    "    1                  ; listing test\n"
+    "    2  1000                    .loc    $1000\n"
+    "    3  1000  a9 01     start:  lda#    1\n"
+    "    4                          .nolist\n"
+    "    8                          .list\n"
+    "    9  1004  85 10             sta     zp1\n"
+    "\fimpala 6502 assembler    impala_listing.p65                        page    2\n"
+    "\n"
+    "   11  1006  4c 1000           jmp     start\n"
+    "   12  1009  ca        loop:   dex\n"
+    "   13  100a  d0 fd             bne     loop\n"
+    "   14  0010                    .def    zp1=$10\n"
+    "   15  0001                    .def    one=1\n"
+    "   16  0002                    .def    two=2\n"
+    "   17  0003                    .def    three=3\n"
+    "\fimpala 6502 assembler    impala_listing.p65                        page    3\n"
+    "\n"
+    "symbols by name\n"
+    "\n"
+    "symbol    value    def  references\n"
+    "loop      1009      12    13\n"
+    "one       0001      15\n"
+    "start     1000       3    11\n"
+    "three     0003      17\n"
+    "two       0002      16\n"
+    "\fimpala 6502 assembler    impala_listing.p65                        page    4\n"
+    "\n"
+    "zp1       0010      14     9\n"
+    "\fimpala 6502 assembler    impala_listing.p65                        page    5\n"
+    "\n"
+    "symbols by value\n"
+    "\n"
+    "symbol    value    def  references\n"
+    "one       0001      15\n"
+    "two       0002      16\n"
+    "three     0003      17\n"
+    "zp1       0010      14     9\n"
+    "start     1000       3    11\n"
+    "\fimpala 6502 assembler    impala_listing.p65                        page    6\n"
+    "\n"
+    "loop      1009      12    13\n";
+  for (unsigned jobs: { 1, 2 })
+  {
+    CHECK(assemble_listing("impala_listing.p65", source, 10, jobs) == expected);
+  }
+}
+
+// The symbol table lists the lines referring to each symbol, once per
+// line. The symbol defined by a .DEF isn't a reference, though the
+// symbols in its value are. Symbols of equal value are listed by name,
+// and an undefined symbol is only listed by name.
+static void test_cross_reference()
+{
+  static constexpr std::string_view source =
+    "\t.def\tfoo=bar\n"
+    "bar:\tnop\n"
+    "\tjmp\tfoo\n"
+    "\tlda\tzed\n"
+    "\t.word\tfoo,bar,foo\n"
+    "\t.def\tabc=bar\n"
+    "\t.def\taaa=$ffff\n"
+    "\tjmp\tabc\n";
+  static constexpr std::string_view expected =
+    "    1  0000                    .def    foo=bar\n"
+    "    2  0000  ea        bar:    nop\n"
+    "    3  0001  4c 0000           jmp     foo\n"
+    "    4                          lda     zed\n"
+    "    5  0007  0000              .word   foo,bar,foo\n"
+    "    6  0000                    .def    abc=bar\n"
+    "    7  ffff                    .def    aaa=$ffff\n"
+    "    8  000d  4c 0000           jmp     abc\n"
+    "\n"
+    "symbols by name\n"
+    "\n"
+    "symbol    value    def  references\n"
+    "aaa       ffff       7\n"
+    "abc       0000       6     8\n"
+    "bar       0000       2     1     5     6\n"
+    "foo       0000       1     3     5\n"
+    "zed       ????             4\n"
+    "\n"
+    "symbols by value\n"
+    "\n"
+    "symbol    value    def  references\n"
+    "abc       0000       6     8\n"
+    "bar       0000       2     1     5     6\n"
+    "foo       0000       1     3     5\n"
+    "aaa       ffff       7\n";
+  for (unsigned jobs: { 1, 2 })
+  {
+    CHECK(assemble_listing("impala_cross_reference.p65", source, 0, jobs) == expected);
+  }
+}
+
+int main()
+{
+  std::filesystem::current_path(std::filesystem::temp_directory_path());
+  test_pagination();
+  test_cross_reference();
+  return test::result();
+}
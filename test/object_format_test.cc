@@ -0,0 +1,140 @@
+// object_format_test.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "memory_image.hh"
+#include "object_format.hh"
+#include "test.hh"
+
+static constexpr std::uint8_t FILL_BYTE = 0xff;
+
+static std::shared_ptr<MemoryImage> create_image(std::initializer_list<std::pair<std::uint16_t, std::vector<std::uint8_t>>> writes)
+{
+  auto image_sp = MemoryImage::create();
+  unsigned source_line_number = 1;
+  for (const auto& [address, bytes]: writes)
+  {
+    image_sp->write(address, bytes, source_line_number++);
+  }
+  return image_sp;
+}
+
+static std::string render(const MemoryImage& image, ObjectFormat format)
+{
+  std::string s;
+  render_object(s, image, format, FILL_BYTE);
+  return s;
+}
+
+static std::string bytes(std::initializer_list<std::uint8_t> bytes)
+{
+  return std::string(bytes.begin(), bytes.end());
+}
+
+static void test_empty()
+{
+  auto image_sp = create_image({ });
+  CHECK(render(*image_sp, ObjectFormat::ASM65) == "");
+  CHECK(render(*image_sp, ObjectFormat::BINARY) == "");
+  CHECK(render(*image_sp, ObjectFormat::PRG) == "");
+  CHECK(render(*image_sp, ObjectFormat::INTEL_HEX) == ":00000001FF\n");
+  CHECK(render(*image_sp, ObjectFormat::S_RECORD) == "S0030000FC\nS9030000FC\n");
+}
+
+static void test_small()
+{
+  auto image_sp = create_image({ { 0x1000, { 0xa9, 0x01, 0x60 } } });
+  CHECK(render(*image_sp, ObjectFormat::ASM65) == "*1000A90160");
+  CHECK(render(*image_sp, ObjectFormat::BINARY) == bytes({ 0xa9, 0x01, 0x60 }));
+  CHECK(render(*image_sp, ObjectFormat::PRG) == bytes({ 0x00, 0x10, 0xa9, 0x01, 0x60 }));
+  CHECK(render(*image_sp, ObjectFormat::INTEL_HEX) ==
+	":03100000A90160E3\n"
+	":00000001FF\n");
+  CHECK(render(*image_sp, ObjectFormat::S_RECORD) ==
+	"S0030000FC\n"
+	"S1061000A90160DF\n"
+	"S9030000FC\n");
+}
+
+// The binary formats fill the gap; the others start a new record.
+static void test_gap()
+{
+  auto image_sp = create_image({ { 0x1000, { 0xa9, 0x01 } },
+				 { 0x1010, { 0x60 } } });
+  std::string binary = bytes({ 0xa9, 0x01 }) + std::string(14, char(FILL_BYTE)) + bytes({ 0x60 });
+  CHECK(render(*image_sp, ObjectFormat::ASM65) == "*1000A901*101060");
+  CHECK(render(*image_sp, ObjectFormat::BINARY) == binary);
+  CHECK(render(*image_sp, ObjectFormat::PRG) == bytes({ 0x00, 0x10 }) + binary);
+  CHECK(render(*image_sp, ObjectFormat::INTEL_HEX) ==
+	":02100000A90144\n"
+	":01101000607F\n"
+	":00000001FF\n");
+  CHECK(render(*image_sp, ObjectFormat::S_RECORD) ==
+	"S0030000FC\n"
+	"S1051000A90140\n"
+	"S1041010607B\n"
+	"S9030000FC\n");
+}
+
+// A range longer than a record is split into records of 16 bytes,
+// counted from the start of the range.
+static void test_record_boundary()
+{
+  std::vector<std::uint8_t> data;
+  for (std::uint8_t i = 0; i < 20; i++)
+  {
+    data.push_back(i);
+  }
+  auto image_sp = create_image({ { 0x1008, data } });
+  std::string binary(data.begin(), data.end());
+  CHECK(render(*image_sp, ObjectFormat::ASM65) == "*1008000102030405060708090A0B0C0D0E0F10111213");
+  CHECK(render(*image_sp, ObjectFormat::BINARY) == binary);
+  CHECK(render(*image_sp, ObjectFormat::PRG) == bytes({ 0x08, 0x10 }) + binary);
+  CHECK(render(*image_sp, ObjectFormat::INTEL_HEX) ==
+	":10100800000102030405060708090A0B0C0D0E0F60\n"
+	":04101800101112138E\n"
+	":00000001FF\n");
+  CHECK(render(*image_sp, ObjectFormat::S_RECORD) ==
+	"S0030000FC\n"
+	"S1131008000102030405060708090A0B0C0D0E0F5C\n"
+	"S1071018101112138A\n"
+	"S9030000FC\n");
+}
+
+// Code that wraps from $FFFF to $0000 is two ranges, output in address
+// order, so the binary formats cover all 64K.
+static void test_wrap()
+{
+  auto image_sp = create_image({ { 0xfffe, { 0x01, 0x02, 0x03, 0x04 } } });
+  std::string binary = bytes({ 0x03, 0x04 }) + std::string(0x10000 - 4, char(FILL_BYTE)) + bytes({ 0x01, 0x02 });
+  CHECK(render(*image_sp, ObjectFormat::ASM65) == "*00000304*FFFE0102");
+  CHECK(render(*image_sp, ObjectFormat::BINARY) == binary);
+  CHECK(render(*image_sp, ObjectFormat::PRG) == bytes({ 0x00, 0x00 }) + binary);
+  CHECK(render(*image_sp, ObjectFormat::INTEL_HEX) ==
+	":020000000304F7\n"
+	":02FFFE000102FE\n"
+	":00000001FF\n");
+  CHECK(render(*image_sp, ObjectFormat::S_RECORD) ==
+	"S0030000FC\n"
+	"S10500000304F3\n"
+	"S105FFFE0102FA\n"
+	"S9030000FC\n");
+}
+
+int main()
+{
+  test_empty();
+  test_small();
+  test_gap();
+  test_record_boundary();
+  test_wrap();
+  return test::result();
+}
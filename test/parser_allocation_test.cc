@@ -0,0 +1,159 @@
+// parser_allocation_test.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+
+#include "ast_arena.hh"
+#include "instruction_set.hh"
+#include "parser.hh"
+#include "symbol_table.hh"
+#include "test.hh"
+
+// Every allocation through the global operator new is counted,
+// including the aligned forms, which std::pmr::new_delete_resource()
+// may use.
+static std::atomic<std::size_t> s_allocation_count = 0;
+
+void* operator new(std::size_t size)
+{
+  ++s_allocation_count;
+  if (void* p = std::malloc(size ? size : 1))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+  ++s_allocation_count;
+  std::size_t align = static_cast<std::size_t>(alignment);
+  if (void* p = std::aligned_alloc(align, ((size + align - 1) / align) * align))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, [[maybe_unused]] std::size_t size) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, [[maybe_unused]] std::align_val_t alignment) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p,
+		     [[maybe_unused]] std::size_t size,
+		     [[maybe_unused]] std::align_val_t alignment) noexcept
+{
+  std::free(p);
+}
+
+// The AST arena gets its blocks from the default memory resource, so
+// allocations for the arena can be told apart from any others.
+class CountingResource: public std::pmr::memory_resource
+{
+public:
+  std::size_t get_allocation_count() const
+  {
+    return m_allocation_count;
+  }
+
+protected:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    ++m_allocation_count;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+  {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+  {
+    return this == &other;
+  }
+
+  std::size_t m_allocation_count = 0;
+};
+
+static constexpr std::array<std::string_view, 16> s_lines
+{
+  "; comment only",
+  "",
+  "\t.def\tzp1=$10",
+  "\t.loc\t$1000",
+  "begin:\tlda#\t5\t; comment",
+  "\tsta\tzp1",
+  "\tldaX\tzp1",
+  "\tlda@y\tptr",
+  "\tjmp@\tvector",
+  "\tldx#\t<table",
+  "loop:\tdex",
+  "\tbne\tloop",
+  "\tlda#\t(2+3)*4-.+begin/7",
+  "\trola",
+  "table:\t.byte\t1,2,3,'A",
+  "\t.ascii\t\"Hello, world\"",
+};
+
+// Parsing allocates nothing once the parser has seen every line and
+// symbol, other than the occasional, geometrically growing, blocks of
+// the AST arena.
+static void test_parse_allocations()
+{
+  CountingResource arena_upstream;
+  std::pmr::memory_resource* previous_default = std::pmr::set_default_resource(&arena_upstream);
+  {
+    auto parser_sp = Parser::create(InstructionSet::create(),
+				    SymbolTable::create(),
+				    ASTArena::create());
+
+    // warm up
+    for (std::string_view line: s_lines)
+    {
+      parser_sp->parse(1, line);
+    }
+
+    static constexpr unsigned REPETITIONS = 1000;
+    std::size_t allocation_count = s_allocation_count;
+    std::size_t arena_allocation_count = arena_upstream.get_allocation_count();
+    for (unsigned i = 0; i < REPETITIONS; i++)
+    {
+      for (std::string_view line: s_lines)
+      {
+	parser_sp->parse(i + 2, line);
+      }
+    }
+    allocation_count = s_allocation_count - allocation_count;
+    arena_allocation_count = arena_upstream.get_allocation_count() - arena_allocation_count;
+
+    // nothing but arena blocks, and far fewer of those than lines
+    CHECK(allocation_count == arena_allocation_count);
+    CHECK(arena_allocation_count * 100 < REPETITIONS * s_lines.size());
+  }
+  std::pmr::set_default_resource(previous_default);
+}
+
+int main()
+{
+  test_parse_allocations();
+  return test::result();
+}
@@ -0,0 +1,133 @@
+// parser_test.cc
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <string>
+
+#include "ast_arena.hh"
+#include "ast_node.hh"
+#include "instruction_set.hh"
+#include "parser.hh"
+#include "symbol_table.hh"
+#include "test.hh"
+
+static std::shared_ptr<Parser> create_parser()
+{
+  return Parser::create(InstructionSet::create(),
+			SymbolTable::create(),
+			ASTArena::create());
+}
+
+// The value of a single-constant operand, as compiled.
+static std::uint32_t get_constant_operand(const Statement* statement)
+{
+  return statement->get_operand_program(0).get_code()[0].operand;
+}
+
+// The column of the ParseError thrown, or zero.
+static unsigned parse_error_column(Parser& parser,
+				   std::string_view line)
+{
+  try
+  {
+    parser.parse(1, line);
+  }
+  catch (const ParseError& e)
+  {
+    return e.get_column();
+  }
+  return 0;
+}
+
+// Returns the message of the ParseError thrown, or an empty string.
+static std::string parse_error_message(Parser& parser,
+				       std::string_view line)
+{
+  try
+  {
+    parser.parse(1, line);
+  }
+  catch (const ParseError& e)
+  {
+    return e.what();
+  }
+  return "";
+}
+
+static void test_constant_range()
+{
+  auto parser_sp = create_parser();
+  CHECK(get_constant_operand(parser_sp->parse(1, "\tlda\t$ffff")) == 0xffff);
+  CHECK(get_constant_operand(parser_sp->parse(2, "\tlda\t65535")) == 65535);
+  CHECK(get_constant_operand(parser_sp->parse(3, "\tlda\t%177777")) == 0xffff);
+
+  // constants too large for 16 bits were once silently truncated
+  CHECK(parse_error_message(*parser_sp, "\tlda\t$12345").contains("out of range"));
+  CHECK(parse_error_message(*parser_sp, "\tlda\t65536").contains("out of range"));
+  CHECK(parse_error_message(*parser_sp, "\tlda\t%200000").contains("out of range"));
+  CHECK(parse_error_message(*parser_sp, "\t.word\t$ffffffffffffffffffff").contains("out of range"));
+}
+
+// A statement must match the whole line; anything left over is a
+// syntax error rather than silently ignored.
+static void test_whole_line()
+{
+  auto parser_sp = create_parser();
+  CHECK(parse_error_message(*parser_sp, "\tlda\t5 5").contains("syntax error"));
+  CHECK(parse_error_message(*parser_sp, "\tfoo\t5").contains("syntax error"));
+  CHECK(parse_error_message(*parser_sp, "\tnop\tnop").contains("syntax error"));
+  CHECK(parse_error_message(*parser_sp, "\tlda\tsymbolnames").contains("syntax error"));  // too long
+
+  // an operator without a following operand, which once left the
+  // operator on the AST stack and failed with an internal error
+  CHECK(parse_error_message(*parser_sp, "\tlda\tfoo+").contains("syntax error"));
+  CHECK(parse_error_message(*parser_sp, "\tlda\ta*<5").contains("syntax error"));
+  CHECK(parse_error_message(*parser_sp, "\tlda\ta+<5").contains("syntax error"));
+  CHECK(parse_error_message(*parser_sp, "\tlda\ta+(1").contains("syntax error"));
+  CHECK(parse_error_message(*parser_sp, "\t.byte\t1,<2").contains("syntax error"));
+  CHECK(get_constant_operand(parser_sp->parse(1, "\tlda\t5")) == 5);
+
+  // trailing whitespace and comments are still allowed
+  const Statement* statement = parser_sp->parse(1, "\tnop \t");
+  CHECK(statement->get_mnemonic_kind() == MnemonicKind::INSTRUCTION);
+  statement = parser_sp->parse(2, "loop:\tbne\tloop\t; comment");
+  CHECK(statement->has_label());
+  CHECK(statement->get_operand_count() == 1);
+}
+
+// The column of a parse error is where the parser gave up, counting
+// from one, with tabs expanded to the next multiple of eight.
+static void test_parse_error_column()
+{
+  auto parser_sp = create_parser();
+  CHECK(parse_error_column(*parser_sp, "\tlda\t5 5") == 19);
+  CHECK(parse_error_column(*parser_sp, "\tfoo\t5") == 9);
+  CHECK(parse_error_column(*parser_sp, "lda 5 )") == 7);
+  CHECK(parse_error_column(*parser_sp, "\tlda\t1+$12345") == 19);
+  CHECK(parse_error_column(*parser_sp, "\t.byte\t1,%200000") == 19);
+  CHECK(parse_error_column(*parser_sp, "\tlda\tfoo+") == 20);
+  CHECK(parse_error_column(*parser_sp, "\t.byte\t1,<2") == 18);
+}
+
+// A comment may start in column 1, as well as after whitespace.
+static void test_comment()
+{
+  auto parser_sp = create_parser();
+  const Statement* statement = parser_sp->parse(1, "; comment");
+  CHECK(! statement->has_label());
+  CHECK(statement->get_mnemonic_kind() == MnemonicKind::NONE);
+  statement = parser_sp->parse(2, "\t; comment");
+  CHECK(statement->get_mnemonic_kind() == MnemonicKind::NONE);
+  statement = parser_sp->parse(3, "\tnop;comment");
+  CHECK(statement->get_mnemonic_kind() == MnemonicKind::INSTRUCTION);
+}
+
+int main()
+{
+  test_constant_range();
+  test_whole_line();
+  test_parse_error_column();
+  test_comment();
+  return test::result();
+}
@@ -0,0 +1,58 @@
+// test.hh
+//
+// Copyright 2025 Eric Smith
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef TEST_HH
+#define TEST_HH
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+// Minimal checks for the test programs. A failed check is reported and
+// counted, and the test continues; main() returns test::result().
+#define CHECK(condition) test::check((condition), #condition, __FILE__, __LINE__)
+
+namespace test
+{
+  inline unsigned failures = 0;
+
+  inline void check(bool ok,
+		    const char* condition,
+		    const char* file,
+		    int line)
+  {
+    if (! ok)
+    {
+      std::cerr << std::format("{}:{}: check failed: {}\n", file, line, condition);
+      ++failures;
+    }
+  }
+
+  inline int result()
+  {
+    if (failures)
+    {
+      std::cerr << std::format("{} checks failed\n", failures);
+      return 1;
+    }
+    return 0;
+  }
+
+  // Writes a source file to the temporary directory, for tests that
+  // assemble a whole file.
+  inline std::filesystem::path write_source(std::string_view name,
+					    std::string_view text)
+  {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+    std::ofstream file(path, std::ios::binary);
+    file << text;
+    return path;
+  }
+}
+
+#endif // TEST_HH